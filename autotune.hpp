@@ -0,0 +1,274 @@
+#ifndef __AUTOTUNE_H__
+#define __AUTOTUNE_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+
+// Per-machine selection of forward kernels.
+//
+// autotune() times every kernel variant (see KERNEL_VARIANTS in mlp.hpp) on every
+// perceptron layer of a model, in isolation and on random data, and switches each layer
+// to its fastest variant for single-sample feeds and for feed_batch. The choice depends on
+// the host, so it is cached in a small text file keyed by the CPU model from /proc/cpuinfo,
+// the register_size_bits pure_simd was compiled for, the float size and the topology:
+//
+//     <cpu model>|simd256|f4|4-7-3-3<TAB>0,0 5,0 0,2
+//
+// one "feed,batch" pair per layer. tune_or_load() applies a cached entry when there is
+// one and tunes (and records) otherwise.
+
+namespace meta_ai
+{
+    inline std::string cpu_model_name()
+    {
+        std::string name = "unknown";
+        FILE *file = fopen("/proc/cpuinfo", "r");
+        if (!file)
+            return name;
+
+        char line[512];
+        while (fgets(line, sizeof(line), file))
+        {
+            if (strncmp(line, "model name", 10) != 0)
+                continue;
+            char const *value = strchr(line, ':');
+            if (!value)
+                continue;
+            value += strspn(value + 1, " \t") + 1;
+            name.assign(value, strcspn(value, "\r\n"));
+            break;
+        }
+        fclose(file);
+        return name;
+    }
+
+    template <typename Model>
+    std::string tuning_key()
+    {
+        std::string key = cpu_model_name() + "|simd" + std::to_string(pure_simd::register_size_bits) +
+                          "|f" + std::to_string(sizeof(typename Model::value_type)) + "|";
+        auto const widths = Model::topology();
+        for (std::size_t i = 0; i < widths.size(); ++i)
+        {
+            key += (i ? "-" : "") + std::to_string(widths[i]);
+        }
+        return key;
+    }
+
+    inline std::string kernel_name(std::size_t variant)
+    {
+        if (variant == 0)
+            return "builtin";
+        return std::to_string(kernel_rows(variant)) + "x" + std::to_string(kernel_tile(variant));
+    }
+
+    namespace detail
+    {
+        // Stands in for the previous layer when a layer is timed on its own.
+        template <typename V>
+        struct tuning_input
+        {
+            V outputs;
+            V const &get_outputs() const { return outputs; }
+        };
+
+        // Values in [0, 1] from fast_rand's recurrence on a local state, so tuning leaves
+        // the seed of the models built afterwards alone.
+        template <typename V>
+        void fill_tuning_input(V &v)
+        {
+            unsigned int seed = 5;
+            for (auto &x : v)
+            {
+                seed = 214013 * seed + 2531011;
+                x = (float)((seed >> 16) & 0x7FFF) / FAST_RAND_MAX;
+            }
+            v[v.size() - 1] = 1;
+        }
+
+        // Best per-call time over a few rounds, each long enough to dwarf the clock.
+        template <typename F>
+        double per_call_ns(F &&func)
+        {
+            using clock = std::chrono::steady_clock;
+            func();
+
+            int calls = 1;
+            for (;;)
+            {
+                auto const t0 = clock::now();
+                for (int k = 0; k < calls; ++k)
+                    func();
+                if (clock::now() - t0 > std::chrono::microseconds(500) || calls >= (1 << 20))
+                    break;
+                calls *= 2;
+            }
+
+            double best = 1e300;
+            for (int round = 0; round < 5; ++round)
+            {
+                auto const t0 = clock::now();
+                for (int k = 0; k < calls; ++k)
+                    func();
+                double const ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / calls;
+                best = ns < best ? ns : best;
+            }
+            return best;
+        }
+
+        // Fastest variant by time(v); another variant must beat the built-in one by 3% to
+        // be picked, so noise does not flip the choice between equivalent kernels.
+        template <typename F>
+        uint8_t fastest_variant(F &&time)
+        {
+            uint8_t best = 0;
+            double best_ns = time(0) * 0.97;
+            for (std::size_t v = 1; v < KERNEL_VARIANTS; ++v)
+            {
+                double const ns = time(v);
+                if (ns < best_ns)
+                {
+                    best = (uint8_t)v;
+                    best_ns = ns;
+                }
+            }
+            return best;
+        }
+
+        inline std::vector<std::pair<std::string, std::string>> read_tuning_file(char const *path)
+        {
+            std::vector<std::pair<std::string, std::string>> entries;
+            FILE *file = fopen(path, "r");
+            if (!file)
+                return entries;
+
+            std::string line;
+            char chunk[256];
+            while (fgets(chunk, sizeof(chunk), file))
+            {
+                line += chunk;
+                if (line.back() != '\n' && !feof(file))
+                    continue;
+                line.erase(line.find_last_not_of("\r\n") + 1);
+                std::size_t const tab = line.find('\t');
+                if (tab != std::string::npos)
+                    entries.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+                line.clear();
+            }
+            fclose(file);
+            return entries;
+        }
+    };
+
+    // Times every variant on every layer of model and switches each layer to the fastest.
+    // Returns the choices, first hidden layer first.
+    template <typename Model>
+    std::vector<kernel_choice> autotune(Model &model)
+    {
+        using float_t = typename Model::value_type;
+        std::vector<kernel_choice> choices;
+
+        model.for_each_layer([&](auto &layer)
+                             {
+                                 using layer_t = std::decay_t<decltype(layer)>;
+                                 using input_t = activations_t<float_t, layer_t::inputs(), 1>;
+                                 using output_t = typename layer_t::outputs_t;
+
+                                 auto prev = std::make_unique<detail::tuning_input<input_t>>();
+                                 detail::fill_tuning_input(prev->outputs);
+                                 std::vector<input_t> batch_in(Model::BATCH);
+                                 std::vector<output_t> batch_out(Model::BATCH);
+                                 for (auto &in : batch_in)
+                                     detail::fill_tuning_input(in);
+
+                                 kernel_choice choice;
+                                 choice.feed = detail::fastest_variant([&](std::size_t v)
+                                                                       {
+                                                                           layer.set_kernels({(uint8_t)v, 0});
+                                                                           return detail::per_call_ns([&]
+                                                                                                      { layer.feed(*prev); }); });
+                                 choice.batch = detail::fastest_variant([&](std::size_t v)
+                                                                        {
+                                                                            layer.set_kernels({0, (uint8_t)v});
+                                                                            return detail::per_call_ns([&]
+                                                                                                       { layer.feed_batch(batch_in.data(), batch_out.data(), Model::BATCH); }); });
+                                 layer.set_kernels(choice);
+                                 choices.push_back(choice); });
+        return choices;
+    }
+
+    // Applies the cached choices for this machine and topology. False, with the model
+    // untouched, when the file has no valid entry for them.
+    template <typename Model>
+    bool load_tuning(Model &model, char const *path)
+    {
+        std::string const key = tuning_key<Model>();
+        for (auto const &entry : detail::read_tuning_file(path))
+        {
+            if (entry.first != key)
+                continue;
+
+            std::vector<kernel_choice> choices;
+            char const *p = entry.second.c_str();
+            unsigned feed, batch;
+            int used;
+            while (sscanf(p, "%u,%u%n", &feed, &batch, &used) == 2)
+            {
+                if (feed >= KERNEL_VARIANTS || batch >= KERNEL_VARIANTS)
+                    return false;
+                choices.push_back({(uint8_t)feed, (uint8_t)batch});
+                p += used;
+            }
+            if (choices.size() != Model::topology().size() - 1)
+                return false;
+
+            std::size_t i = 0;
+            model.for_each_layer([&](auto &layer)
+                                 { layer.set_kernels(choices[i++]); });
+            return true;
+        }
+        return false;
+    }
+
+    // Records the model's current choices, replacing any entry for the same key.
+    template <typename Model>
+    bool save_tuning(Model const &model, char const *path)
+    {
+        std::string const key = tuning_key<Model>();
+        std::string value;
+        model.for_each_layer([&](auto const &layer)
+                             {
+                                 kernel_choice const c = layer.get_kernels();
+                                 value += (value.empty() ? "" : " ") + std::to_string(c.feed) + "," + std::to_string(c.batch); });
+
+        std::string text;
+        for (auto const &entry : detail::read_tuning_file(path))
+        {
+            if (entry.first != key)
+                text += entry.first + "\t" + entry.second + "\n";
+        }
+        text += key + "\t" + value + "\n";
+        return write_file_atomically(path, text.data(), text.size(), nullptr, 0);
+    }
+
+    // Startup helper: cached choices if present, otherwise tune now and cache them.
+    // Returns true on a cache hit.
+    template <typename Model>
+    bool tune_or_load(Model &model, char const *path)
+    {
+        if (load_tuning(model, path))
+            return true;
+        autotune(model);
+        save_tuning(model, path);
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "mlp.hpp"
+#include "autotune.hpp"
+#include "iris.hpp"
+#include <memory>
+#include <vector>
+
+// Forward and training speed of a few topologies with the built-in kernels and with the
+// kernels picked by the autotuner. The first run tunes and writes the cache; later runs
+// load it at startup instead.
+//
+//   ./bench_autotune [cache file] [--retune]
+
+namespace mai = meta_ai;
+
+#define learning_rate 0.01f
+
+template <typename Model>
+void measure(Model &model, std::vector<float> const &input, std::vector<float> const &answer, double times[3])
+{
+    std::size_t const n = input.size() / Model::inputs();
+    std::vector<float> output(n * Model::outputs());
+    int const reps = 16;
+
+    times[0] = funcTime([&]
+                        {
+                            for (int r = 0; r < reps; ++r)
+                                for (std::size_t s = 0; s < n; ++s)
+                                    model.predict(input.data() + s * Model::inputs()); }) / (reps * n);
+    times[1] = funcTime([&]
+                        {
+                            for (int r = 0; r < reps; ++r)
+                                model.predict_batch(input.data(), n, output.data()); }) / (reps * n);
+    times[2] = funcTime([&]
+                        {
+                            for (int r = 0; r < reps; ++r)
+                                for (std::size_t s = 0; s < n; ++s)
+                                    model.train(input.data() + s * Model::inputs(), answer.data() + s * Model::outputs(), learning_rate); }) / (reps * n);
+}
+
+template <typename Model>
+void run(char const *name, char const *cache, bool retune, std::size_t samples)
+{
+    auto model = std::make_unique<Model>();
+    model->xavier_init();
+
+    std::vector<float> input(samples * Model::inputs()), answer(samples * Model::outputs());
+    for (auto &x : input)
+        x = mai::fast_rand() / (float)FAST_RAND_MAX;
+    for (std::size_t s = 0; s < samples; ++s)
+        answer[s * Model::outputs() + s % Model::outputs()] = 1;
+
+    double builtin[3], tuned[3];
+    measure(*model, input, answer, builtin);
+
+    auto const t0 = timeNow();
+    bool hit = false;
+    if (retune)
+    {
+        mai::autotune(*model);
+        mai::save_tuning(*model, cache);
+    }
+    else
+    {
+        hit = mai::tune_or_load(*model, cache);
+    }
+    double const setup_us = duration(timeNow() - t0) / 1000;
+
+    measure(*model, input, answer, tuned);
+
+    std::string kernels;
+    model->for_each_layer([&](auto const &layer)
+                          {
+                              auto const c = layer.get_kernels();
+                              kernels += " " + mai::kernel_name(c.feed) + "/" + mai::kernel_name(c.batch); });
+
+    printf("%-12s %s in %10.0f us, kernels (feed/batch):%s\n", name, hit ? "cache hit " : "tuned     ", setup_us, kernels.c_str());
+    printf("%12s predict %9.1f -> %9.1f ns  predict_batch %9.1f -> %9.1f ns  train %9.1f -> %9.1f ns per sample\n",
+           "", builtin[0], tuned[0], builtin[1], tuned[1], builtin[2], tuned[2]);
+}
+
+int main(int argc, char **argv)
+{
+    char const *cache = argc > 1 ? argv[1] : "kernels.tune";
+    bool const retune = argc > 2 && strcmp(argv[2], "--retune") == 0;
+
+    printf("cache %s, key prefix: %s\n", cache, mai::tuning_key<mai::MLP<float, mai::INPUT<1>, mai::HIDDEN<1>, mai::OUTPUT<1>>>().c_str());
+
+    run<mai::MLP<float, mai::INPUT<4>, mai::HIDDEN<7, 3>, mai::OUTPUT<3>>>("iris", cache, retune, 150);
+    run<mai::MLP<float, mai::INPUT<64>, mai::HIDDEN<64, 64>, mai::OUTPUT<10>>>("64x64", cache, retune, 256);
+    run<mai::MLP<float, mai::INPUT<32>, mai::HIDDEN<200>, mai::OUTPUT<10>>>("32-200-10", cache, retune, 256);
+    run<mai::MLP<float, mai::INPUT<256>, mai::HIDDEN<1024>, mai::OUTPUT<16>>>("256-1024-16", cache, retune, 64);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include "mlp.hpp"
+#include "iris.hpp"
+#include "checkpoint.hpp"
+
+// Training throughput with no checkpoints, with background checkpoints (Checkpointer)
+// and with synchronous save_checkpoint calls at the same interval.
+//
+//   ./bench_checkpoint [checkpoint_path]
+
+#define epochs 2000
+#define learning_rate 0.1
+#define rand_seed 0
+#define checkpoint_every 100
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<64, 64>, mai::OUTPUT<out_cols>>;
+
+Model mlp;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+template <typename F>
+double train_run(char const *name, F &&after_sample)
+{
+    srand(rand_seed);
+    unsigned long samples = 0;
+    double const ns = funcTime([&]
+                               {
+                                   for (int i = 0; i < epochs; i++)
+                                   {
+                                       shuffle(order, train_rows);
+                                       for (int j = 0; j < train_rows; j++)
+                                       {
+                                           int row = order[j];
+                                           mlp.train(feat + row * cols, label + row * out_cols, learning_rate);
+                                           after_sample(++samples);
+                                       }
+                                   } });
+    double const rate = samples / (ns / 1e9);
+    printf("%-12s %10.0f samples/s\n", name, rate);
+    return rate;
+}
+
+int main(int argc, char **argv)
+{
+    char const *path = argc > 1 ? argv[1] : "bench.ckpt";
+
+    readIris(feat, label);
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+
+    printf("Model: %zu weights, %zu bytes per checkpoint, one every %d samples\n",
+           mai::checkpoint_weights<Model>(), sizeof(mai::checkpoint_header) + mai::checkpoint_weights<Model>() * sizeof(float), checkpoint_every);
+
+    double const base = train_run("none", [](unsigned long) {});
+
+    unsigned long written;
+    double async_rate;
+    {
+        mai::Checkpointer<Model> checkpointer(path);
+        async_rate = train_run("background", [&](unsigned long samples)
+                               {
+                                   if (samples % checkpoint_every == 0)
+                                       checkpointer.request(mlp, samples); });
+        checkpointer.wait();
+        written = checkpointer.checkpoints_written();
+    }
+
+    double const sync_rate = train_run("synchronous", [&](unsigned long samples)
+                                       {
+                                           if (samples % checkpoint_every == 0)
+                                               mai::save_checkpoint(mlp, path, samples); });
+
+    printf("background: %.1f%% of baseline (%lu checkpoints written), synchronous: %.1f%%\n",
+           100 * async_rate / base, written, 100 * sync_rate / base);
+
+    // Round trip: the last checkpoint must reproduce the trained model's predictions.
+    Model restored;
+    uint64_t step = 0;
+    if (!mai::load_checkpoint(restored, path, &step))
+    {
+        printf("Could not load %s\n", path);
+        return EXIT_FAILURE;
+    }
+    mai::save_checkpoint(mlp, path, step);
+    mai::load_checkpoint(restored, path, &step);
+    float expected[out_cols], actual[out_cols];
+    mlp.predict_batch(feat, 1, expected);
+    restored.predict_batch(feat, 1, actual);
+    printf("restored step %lu, prediction %s\n", (unsigned long)step,
+           memcmp(expected, actual, sizeof(expected)) == 0 ? "matches" : "DIFFERS");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+#include "iris_model.hpp"
+#include "iris.hpp"
+
+// Single-sample latency of the generated header against the runtime MLP::predict, on the
+// same weights. Run export_iris first: it writes iris_model.hpp and iris_model.ckpt.
+//
+//   ./export_iris && g++ -std=c++17 -Ofast -march=native bench_codegen.cpp -o bench_codegen
+//   ./bench_codegen [checkpoint]
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>>;
+static_assert(iris_model::inputs == cols && iris_model::outputs == out_cols, "iris_model.hpp is for another topology");
+
+Model mlp;
+
+float feat[rows * cols];
+float label[rows * out_cols];
+
+int main(int argc, char **argv)
+{
+    char const *checkpoint = argc > 1 ? argv[1] : "iris_model.ckpt";
+    readIris(feat, label);
+    if (!mai::load_checkpoint(mlp, checkpoint))
+    {
+        fprintf(stderr, "cannot load %s, run export_iris first\n", checkpoint);
+        return EXIT_FAILURE;
+    }
+
+    float max_diff = 0;
+    for (int r = 0; r < rows; ++r)
+    {
+        float generated[out_cols];
+        iris_model::predict(feat + r * cols, generated);
+        auto const &runtime = mlp.predict(feat + r * cols);
+        for (int k = 0; k < out_cols; ++k)
+            max_diff = std::max(max_diff, fabsf(generated[k] - runtime[k]));
+    }
+    printf("max output difference over %d rows: %g\n", rows, max_diff);
+
+    // Dependent chain through a checksum so neither loop can be hoisted or overlapped away.
+    int const reps = 1000000;
+    float sink = 0;
+    double const runtime_ns = funcTime([&]
+                                       {
+                                           for (int i = 0; i < reps; ++i)
+                                               sink += mlp.predict(feat + (i % rows) * cols)[0];
+                                       }) / reps;
+    double const generated_ns = funcTime([&]
+                                         {
+                                             float out[out_cols];
+                                             for (int i = 0; i < reps; ++i)
+                                             {
+                                                 iris_model::predict(feat + (i % rows) * cols, out);
+                                                 sink += out[0];
+                                             } }) / reps;
+    printf("predict: runtime MLP %.1f ns, generated header %.1f ns (checksum %g)\n", runtime_ns, generated_ns, sink);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+#include <sys/wait.h>
+#include "mlp.hpp"
+#include "distributed.hpp"
+#include "sweep.hpp"
+#include "iris.hpp"
+
+// Data-parallel training over N processes on this machine (distributed.hpp). The
+// launcher forks one process per rank for every configuration; rank 0 prints the result.
+//
+// First table: RingAllReduce latency and bus bandwidth (2 (N - 1) / N of the buffer per
+// rank per sum) by transport, precision and size. Second table: the same Iris epochs
+// trained on 1, 2, 4... ranks, each with an interleaved shard of every epoch's shuffle,
+// so a step of N ranks sees exactly the rows of one step of a single process with an
+// N times larger batch; rank 0 reruns that single process afterwards, at 1 / N of the
+// rate since the ranks average their gradients, and reports the largest weight
+// difference, along with the spread between the replicas.
+//
+// usage: bench_data_parallel [max ranks = 4]
+
+#define epochs 200
+#define learning_rate 0.1
+#define batch 4
+#define rand_seed 0
+#define base_port 47100
+
+namespace mai = meta_ai;
+namespace dist = meta_ai::distributed;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<128, 128>, mai::OUTPUT<out_cols>>;
+using Trainer = dist::DataParallelTrainer<Model>;
+
+int split[rows]; // held-out rows are split[train_rows..], shuffled once before forking
+float feat[rows * cols];
+float label[rows * out_cols];
+
+unsigned configs = 0;
+pid_t launcher; // names the shared memory rings of this run
+
+// Runs rank_main(rank) in world forked processes; true if all of them exit with 0.
+template <typename F>
+bool launch(unsigned world, F &&rank_main)
+{
+    fflush(stdout);
+    std::vector<pid_t> pids;
+    for (unsigned r = 0; r < world; ++r)
+    {
+        pid_t const pid = fork();
+        if (pid == 0)
+        {
+            int const rc = rank_main(r);
+            fflush(stdout);
+            _exit(rc);
+        }
+        pids.push_back(pid);
+    }
+    bool ok = true;
+    for (pid_t pid : pids)
+    {
+        int status = 0;
+        ok &= waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return ok;
+}
+
+dist::ring_config make_config(unsigned rank, unsigned world, dist::transport kind, bool fp16)
+{
+    dist::ring_config config;
+    config.rank = rank;
+    config.world = world;
+    config.kind = kind;
+    config.fp16 = fp16;
+    config.port = base_port + 16 * configs;
+    config.shm_name = "mai_bench_" + std::to_string(launcher) + "_" + std::to_string(configs);
+    return config;
+}
+
+char const *transport_name(dist::transport kind) { return kind == dist::transport::tcp ? "tcp" : "shm"; }
+
+void bench_allreduce(unsigned world, dist::transport kind, bool fp16)
+{
+    ++configs;
+    bool const ok = launch(world, [&](unsigned rank)
+                           {
+                               auto ring = dist::RingAllReduce::connect(make_config(rank, world, kind, fp16));
+                               if (!ring)
+                                   return 1;
+                               for (std::size_t n : {std::size_t{1} << 10, std::size_t{1} << 16, std::size_t{1} << 20})
+                               {
+                                   std::vector<float> data(n, 1.0f);
+                                   int const repeats = (int)std::max<std::size_t>(4, (std::size_t{1} << 22) / n);
+                                   ring->sum(data.data(), n); // warm-up
+                                   auto const t0 = timeNow();
+                                   for (int i = 0; i < repeats; ++i)
+                                   {
+                                       std::fill(data.begin(), data.end(), 1.0f);
+                                       if (!ring->sum(data.data(), n))
+                                           return 1;
+                                   }
+                                   double const ns = (double)duration(timeNow() - t0) / repeats;
+                                   if (data[n / 2] != world)
+                                       return 1;
+                                   double const bus = 2.0 * (world - 1) / world * n * (fp16 ? 2 : 4);
+                                   if (rank == 0)
+                                       printf("allreduce  %u ranks  %-3s %-4s %8zu floats  %10.1f us  %8.1f MB/s\n", world, transport_name(kind),
+                                              fp16 ? "fp16" : "fp32", n, ns / 1e3, bus / ns * 1e3);
+                               }
+                               return 0; });
+    if (!ok)
+        printf("allreduce  %u ranks  %-3s %-4s failed\n", world, transport_name(kind), fp16 ? "fp16" : "fp32");
+}
+
+std::vector<float> weights_of(Model &model)
+{
+    std::vector<float> w;
+    model.for_each_layer([&](auto &layer)
+                         {
+                             for (std::size_t i = 0; i < layer.size(); ++i)
+                             {
+                                 float const *row = layer.get_weights().begin()[i].begin();
+                                 w.insert(w.end(), row, row + layer.inputs() + 1);
+                             } });
+    return w;
+}
+
+// Trains the rows order[rank], order[rank + world], ... of every epoch's shuffle.
+bool train_shard(Trainer &trainer, unsigned rank, unsigned world, std::size_t shard, float rate)
+{
+    std::vector<uint32_t> order(train_rows);
+    for (std::size_t i = 0; i < order.size(); ++i)
+        order[i] = (uint32_t)i;
+    std::vector<float> in(shard * cols), out(shard * out_cols);
+    uint64_t rng = rand_seed;
+
+    for (int e = 0; e < epochs; ++e)
+    {
+        mai::detail::shuffle(order, rng);
+        for (std::size_t j = 0; j < shard; ++j)
+        {
+            int const row = split[order[j * world + rank]];
+            std::copy(feat + row * cols, feat + (row + 1) * cols, in.begin() + j * cols);
+            std::copy(label + row * out_cols, label + (row + 1) * out_cols, out.begin() + j * out_cols);
+        }
+        if (!trainer.train(in.data(), out.data(), shard, rate))
+            return false;
+    }
+    return true;
+}
+
+void bench_training(unsigned world, dist::transport kind, bool fp16)
+{
+    ++configs;
+    bool const ok = launch(world, [&](unsigned rank)
+                           {
+                               auto ring = dist::RingAllReduce::connect(make_config(rank, world, kind, fp16));
+                               if (!ring)
+                                   return 1;
+                               mai::fast_srand(rand_seed + rank); // replicas start apart; sync_weights fixes that
+                               auto mlp = std::make_unique<Model>();
+                               mlp->xavier_init();
+                               Trainer trainer(*mlp, *ring, batch);
+                               if (!trainer.sync_weights())
+                                   return 1;
+                               auto reference = std::make_unique<Model>(*mlp);
+
+                               std::size_t const shard = train_rows / world;
+                               auto const t0 = timeNow();
+                               if (!train_shard(trainer, rank, world, shard, learning_rate))
+                                   return 1;
+                               double const ms = duration(timeNow() - t0) / 1e6;
+
+                               float spread = 0;
+                               if (!trainer.divergence(spread))
+                                   return 1;
+                               if (rank != 0)
+                                   return 0;
+
+                               int correct = 0;
+                               for (int i = train_rows; i < rows; ++i)
+                                   correct += argmax_matches(mlp->predict(feat + split[i] * cols).begin(), label + split[i] * out_cols);
+
+                               // One process, batch world * batch, same rows and step size.
+                               auto solo = dist::RingAllReduce::connect({});
+                               Trainer single(*reference, *solo, world * batch);
+                               train_shard(single, 0, 1, shard * world, (float)learning_rate / world);
+                               std::vector<float> const a = weights_of(*mlp), b = weights_of(*reference);
+                               float max_diff = 0;
+                               for (std::size_t i = 0; i < a.size(); ++i)
+                                   max_diff = std::max(max_diff, fabsf(a[i] - b[i]));
+
+                               double const samples = (double)epochs * shard * world;
+                               printf("training   %u ranks  %-3s %-4s  %8.0f ms  %9.0f samples/s  reduce %5.1f%%  %7.1f MB sent/rank  correct %2d/%d  "
+                                      "replica spread %g  max diff vs 1 process %g\n",
+                                      world, transport_name(kind), fp16 ? "fp16" : "fp32", ms, samples / ms * 1e3, 100 * trainer.reduce_ms() / ms,
+                                      ring->bytes_sent() / 1e6, correct, rows - train_rows, spread, max_diff);
+                               return 0; });
+    if (!ok)
+        printf("training   %u ranks  %-3s %-4s failed\n", world, transport_name(kind), fp16 ? "fp16" : "fp32");
+}
+
+int main(int argc, char **argv)
+{
+    unsigned const max_world = argc > 1 ? (unsigned)atoi(argv[1]) : 4;
+    launcher = getpid();
+    srand(rand_seed);
+    readIris(feat, label);
+    for (int i = 0; i < rows; ++i)
+        split[i] = i;
+    shuffle(split, rows);
+    printf("%u hardware threads; ranks beyond that share cores\n", std::thread::hardware_concurrency());
+
+    for (unsigned world = 2; world <= max_world; world *= 2)
+        for (auto kind : {dist::transport::tcp, dist::transport::shm})
+            for (bool fp16 : {false, true})
+                bench_allreduce(world, kind, fp16);
+
+    bench_training(1, dist::transport::shm, false);
+    for (unsigned world = 2; world <= max_world; world *= 2)
+        for (auto kind : {dist::transport::tcp, dist::transport::shm})
+            for (bool fp16 : {false, true})
+                bench_training(world, kind, fp16);
+
+    return EXIT_SUCCESS;
+}
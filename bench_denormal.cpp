@@ -0,0 +1,109 @@
+#include "mlp.hpp"
+#include "numerics.hpp"
+#include "sweep.hpp"
+#include "iris.hpp"
+
+// Training throughput of a saturated model with gradual underflow (IEEE subnormals)
+// against FTZ/DAZ, both set through DenormalScope, with HealthMonitor counting the
+// subnormal, NaN and Inf values it finds. The hidden biases start at -50, so every hidden
+// sigmoid sits saturated near 2e-22, as dead neurons of a long run do; products of two
+// such values, in the deltas and the weight updates, are subnormal. A second pair of
+// runs with a far too large learning rate shows the monitor catching NaN.
+// Finally checks that WorkStealingPool workers follow the scope.
+
+#define epochs 200
+#define learning_rate 0.1
+#define diverging_rate 30
+#define saturated_bias -50
+#define rand_seed 0
+#define sample_every 64
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<64, 64, 64>, mai::OUTPUT<out_cols>>;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+void run(char const *name, mai::denormals mode, float rate, bool saturate)
+{
+    mai::DenormalScope scope(mode);
+    srand(rand_seed);
+    mai::fast_srand(rand_seed);
+    auto mlp = std::make_unique<Model>();
+    mlp->xavier_init();
+    if (saturate)
+    {
+        std::size_t l = 0;
+        mlp->for_each_layer([&](auto &layer)
+                            {
+                                if (++l == Model::depth())
+                                    return;
+                                for (std::size_t i = 0; i < layer.size(); ++i)
+                                    layer.get_weights().begin()[i].begin()[layer.inputs()] = saturated_bias; });
+    }
+    mai::HealthMonitor<Model> monitor(sample_every);
+
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    double const ns = funcTime([&]
+                               {
+                                   for (int e = 0; e < epochs; e++)
+                                   {
+                                       shuffle(order, train_rows);
+                                       for (int j = 0; j < train_rows; j++)
+                                       {
+                                           int row = order[j];
+                                           mlp->train(feat + row * cols, label + row * out_cols, rate);
+                                           monitor.observe(*mlp);
+                                       }
+                                   } });
+
+    int correct = 0;
+    for (int i = train_rows; i < rows; ++i)
+    {
+        int row = order[i];
+        correct += argmax_matches(mlp->predict(feat + row * cols).begin(), label + row * out_cols);
+    }
+
+    printf("%-6s FTZ/DAZ %s  %8.1f ns/sample  correct %2d/%d\n", name, mai::flushing_denormals() ? "on " : "off",
+           ns / (epochs * train_rows), correct, rows - train_rows);
+    monitor.print();
+}
+
+int main(int argc, char **argv)
+{
+    readIris(feat, label);
+
+    run("keep", mai::denormals::keep, learning_rate, true);
+    run("flush", mai::denormals::flush, learning_rate, true);
+    run("keep", mai::denormals::keep, diverging_rate, false);
+    run("flush", mai::denormals::flush, diverging_rate, false);
+
+    mai::WorkStealingPool pool(2);
+    std::atomic<int> flushing{0};
+    auto probe = [&]
+    {
+        std::vector<std::function<void()>> jobs;
+        for (int j = 0; j < 8; ++j)
+            jobs.push_back([&]
+                           { flushing += mai::flushing_denormals(); });
+        flushing = 0;
+        pool.run(std::move(jobs));
+        return flushing.load();
+    };
+    {
+        mai::DenormalScope keep(mai::denormals::keep);
+        printf("pool jobs flushing inside a keep scope: %d/8\n", probe());
+        {
+            mai::DenormalScope flush(mai::denormals::flush);
+            printf("pool jobs flushing inside a nested flush scope: %d/8\n", probe());
+        }
+        printf("pool jobs flushing after it closed: %d/8\n", probe());
+    }
+
+    return EXIT_SUCCESS;
+}
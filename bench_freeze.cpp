@@ -0,0 +1,155 @@
+#include <memory>
+#include "mlp.hpp"
+#include "freeze.hpp"
+#include "iris.hpp"
+
+// Fine-tuning a trained model on new data: every layer through MLP::train against only
+// the last layers through FrozenPrefixTrainer (freeze.hpp), whose frozen prefix runs once
+// per sample into a cache held in memory or in a mapped file. The new data are the Iris
+// measurements after a recalibration (scaled and offset). A reference run of MLP::train
+// that puts the prefix weights back after every step must match the frozen run exactly.
+
+#define pretrain_epochs 300
+#define finetune_epochs 20
+#define learning_rate 0.1
+#define rand_seed 0
+#define cache_path "freeze_cache.bin"
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<512, 512, 32>, mai::OUTPUT<out_cols>>;
+
+int order[rows];
+float feat[rows * cols];
+float shifted[rows * cols];
+float label[rows * out_cols];
+
+// Training rows in split order, contiguous, for the cache.
+float train_feat[train_rows * cols];
+float train_label[train_rows * out_cols];
+
+int correct_on(Model &mlp, float const *data)
+{
+    int correct = 0;
+    for (int i = train_rows; i < rows; ++i)
+    {
+        int row = order[i];
+        correct += argmax_matches(mlp.predict(data + row * cols).begin(), label + row * out_cols);
+    }
+    return correct;
+}
+
+template <std::size_t FROZEN>
+void report_frozen(Model const &trained, char const *path, Model *reference)
+{
+    auto mlp = std::make_unique<Model>(trained);
+    mai::FrozenPrefixTrainer<Model, FROZEN> trainer(*mlp);
+
+    double const cache_ns = funcTime([&]
+                                     {
+                                         if (!trainer.cache(train_feat, train_rows, path))
+                                             printf("cannot map %s\n", path); });
+    int idx[train_rows];
+    for (int i = 0; i < train_rows; ++i)
+        idx[i] = i;
+    double const ns = funcTime([&]
+                               {
+                                   for (int e = 0; e < finetune_epochs; ++e)
+                                   {
+                                       shuffle(idx, train_rows);
+                                       for (int j = 0; j < train_rows; ++j)
+                                           trainer.train(idx[j], train_label + idx[j] * out_cols, learning_rate);
+                                   } });
+
+    float max_diff = 0;
+    if (reference)
+    {
+        auto diff = [&](auto const &a, auto const &b)
+        {
+            for (std::size_t i = 0; i < a.size(); ++i)
+                for (std::size_t k = 0; k <= a.inputs(); ++k)
+                    max_diff = std::max(max_diff, fabsf(a.get_weights().begin()[i].begin()[k] - b.get_weights().begin()[i].begin()[k]));
+        };
+        diff(mlp->template layer<0>(), reference->template layer<0>());
+        diff(mlp->template layer<1>(), reference->template layer<1>());
+        diff(mlp->template layer<2>(), reference->template layer<2>());
+        diff(mlp->template layer<3>(), reference->template layer<3>());
+    }
+
+    printf("frozen %zu of %zu, %-6s cache  %8zu bytes built in %7.1f ms  fine-tune %8.1f ms  correct %2d/%d",
+           FROZEN, Model::depth(), path ? "mapped" : "memory", trainer.bytes(), cache_ns / 1e6, ns / 1e6,
+           correct_on(*mlp, shifted), rows - train_rows);
+    if (reference)
+        printf("  max diff vs reference %g", max_diff);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    srand(rand_seed);
+    readIris(feat, label);
+    for (int i = 0; i < rows * cols; ++i)
+        shifted[i] = 0.8f * feat[i] - 0.5f;
+
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+    for (int j = 0; j < train_rows; ++j)
+    {
+        std::copy(shifted + order[j] * cols, shifted + (order[j] + 1) * cols, train_feat + j * cols);
+        std::copy(label + order[j] * out_cols, label + (order[j] + 1) * out_cols, train_label + j * out_cols);
+    }
+
+    auto trained = std::make_unique<Model>();
+    trained->xavier_init();
+    for (int e = 0; e < pretrain_epochs; ++e)
+    {
+        shuffle(order, train_rows);
+        for (int j = 0; j < train_rows; ++j)
+            trained->train(feat + order[j] * cols, label + order[j] * out_cols, learning_rate);
+    }
+    printf("trained: correct %2d/%d on the original data, %2d/%d after the recalibration\n",
+           correct_on(*trained, feat), rows - train_rows, correct_on(*trained, shifted), rows - train_rows);
+
+    // Reference and frozen runs draw the same epoch orders from srand.
+    int idx[train_rows];
+    auto full = std::make_unique<Model>(*trained);
+    srand(rand_seed + 1);
+    for (int i = 0; i < train_rows; ++i)
+        idx[i] = i;
+    double const full_ns = funcTime([&]
+                                    {
+                                        for (int e = 0; e < finetune_epochs; ++e)
+                                        {
+                                            shuffle(idx, train_rows);
+                                            for (int j = 0; j < train_rows; ++j)
+                                                full->train(train_feat + idx[j] * cols, train_label + idx[j] * out_cols, learning_rate);
+                                        } });
+    printf("all %zu layers trained                                              fine-tune %8.1f ms  correct %2d/%d\n",
+           Model::depth(), full_ns / 1e6, correct_on(*full, shifted), rows - train_rows);
+
+    auto reference = std::make_unique<Model>(*trained);
+    srand(rand_seed + 1);
+    for (int i = 0; i < train_rows; ++i)
+        idx[i] = i;
+    for (int e = 0; e < finetune_epochs; ++e)
+    {
+        shuffle(idx, train_rows);
+        for (int j = 0; j < train_rows; ++j)
+        {
+            reference->train(train_feat + idx[j] * cols, train_label + idx[j] * out_cols, learning_rate);
+            reference->layer<0>().get_weights() = trained->layer<0>().get_weights();
+            reference->layer<1>().get_weights() = trained->layer<1>().get_weights();
+        }
+    }
+
+    srand(rand_seed + 1);
+    report_frozen<2>(*trained, nullptr, reference.get());
+    srand(rand_seed + 1);
+    report_frozen<2>(*trained, cache_path, reference.get());
+    srand(rand_seed + 1);
+    report_frozen<3>(*trained, nullptr, nullptr);
+    unlink(cache_path);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include "mlp.hpp"
+#include "iris.hpp"
+#include "model_handle.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Readers keep predicting through a ModelHandle while a writer retrains copies of the
+// model. The run is done twice: once with the writer only training, once with it also
+// publishing each retrained model, and compares reader latency between the two.
+//
+//   ./bench_hot_swap [readers] [seconds]
+
+#define learning_rate 0.1
+#define rand_seed 0
+#define epochs_per_version 200
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>>;
+using Handle = mai::ModelHandle<Model>;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+void retrain(Model &model, int epochs)
+{
+    for (int i = 0; i < epochs; i++)
+    {
+        shuffle(order, train_rows);
+        for (int j = 0; j < train_rows; j++)
+        {
+            int row = order[j];
+            model.train(feat + row * cols, label + row * out_cols, learning_rate);
+        }
+    }
+}
+
+void read_loop(Handle *handle, std::atomic<bool> *stop, std::vector<double> *latencies, unsigned long *predictions)
+{
+    Handle::reader reader(*handle);
+    float output[out_cols];
+    int row = 0;
+    while (!stop->load(std::memory_order_relaxed))
+    {
+        auto const t0 = timeNow();
+        {
+            auto model = reader.pin();
+            model->predict_batch(feat + row * cols, 1, output);
+        }
+        latencies->push_back(duration(timeNow() - t0));
+        row = (row + 1) % rows;
+        ++*predictions;
+    }
+}
+
+void run(char const *name, bool publish, int readers, int seconds)
+{
+    Handle handle(std::unique_ptr<Model>(new Model));
+    std::atomic<bool> stop{false};
+    std::vector<std::vector<double>> latencies(readers);
+    std::vector<unsigned long> predictions(readers, 0);
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r)
+    {
+        latencies[r].reserve(1 << 22);
+        threads.emplace_back(read_loop, &handle, &stop, &latencies[r], &predictions[r]);
+    }
+
+    int versions = 0;
+    auto const end = timeNow() + std::chrono::seconds(seconds);
+    while (timeNow() < end)
+    {
+        auto next = handle.clone();
+        retrain(*next, epochs_per_version);
+        if (publish)
+            handle.publish(std::move(next));
+        ++versions;
+    }
+    stop = true;
+    for (auto &t : threads)
+        t.join();
+    handle.reclaim();
+
+    std::vector<double> all;
+    unsigned long total = 0;
+    for (int r = 0; r < readers; ++r)
+    {
+        all.insert(all.end(), latencies[r].begin(), latencies[r].end());
+        total += predictions[r];
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p)
+    { return all[std::min(all.size() - 1, (std::size_t)(p * all.size()))]; };
+
+    printf("%-10s %3d versions, %zu reclaimed, %8.0f predictions/s, latency ns p50 %.0f p99 %.0f p99.9 %.0f max %.0f\n",
+           name, versions, (std::size_t)handle.reclaimed_models(), total / (double)seconds,
+           percentile(0.5), percentile(0.99), percentile(0.999), all.back());
+}
+
+int main(int argc, char **argv)
+{
+    int const readers = argc > 1 ? atoi(argv[1]) : 2;
+    int const seconds = argc > 2 ? atoi(argv[2]) : 3;
+
+    srand(rand_seed);
+    readIris(feat, label);
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    run("no swaps", false, readers, seconds);
+    run("swapping", true, readers, seconds);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include "mlp.hpp"
+#include "intra_op.hpp"
+#include "iris.hpp"
+#include <memory>
+#include <vector>
+
+// Single-request latency of INPUT<W> -> HIDDEN<W> -> OUTPUT<W> models with the wide
+// layers split across an IntraOpPool of 1, 2, 4, ... threads. Layers under
+// INTRA_OP_MIN_MACS, and unrolled ones, stay on the calling thread whatever the pool.
+//
+//   ./bench_intra_op [max threads]     default: every core, at least 2
+
+namespace mai = meta_ai;
+
+#define learning_rate 0.01f
+
+// Median of calls timed one by one, in microseconds.
+template <typename F>
+double median_us(int calls, F &&func)
+{
+    std::vector<double> times(calls);
+    for (auto &t : times)
+        t = funcTime(func) / 1000;
+    std::nth_element(times.begin(), times.begin() + calls / 2, times.end());
+    return times[calls / 2];
+}
+
+template <std::size_t W>
+void run(std::vector<std::size_t> const &thread_counts)
+{
+    using Model = mai::MLP<float, mai::INPUT<W>, mai::HIDDEN<W>, mai::OUTPUT<W>>;
+
+    std::vector<float> input(W), answer(W), reference(W);
+    for (auto &x : input)
+        x = mai::fast_rand() / (float)FAST_RAND_MAX;
+    for (std::size_t i = 0; i < W; ++i)
+        answer[i] = i % 2;
+
+    double const macs = 2.0 * W * (W + 1);
+    int const calls = std::max(20, (int)(2e8 / macs));
+
+    for (std::size_t threads : thread_counts)
+    {
+        mai::fast_srand(5);
+        auto model = std::make_unique<Model>();
+        model->xavier_init();
+        mai::IntraOpPool pool(threads);
+        std::size_t const split = mai::enable_intra_op(*model, &pool);
+
+        double const predict_us = median_us(calls, [&]
+                                            { model->predict(input.data()); });
+        double const train_us = median_us(calls, [&]
+                                          { model->train(input.data(), answer.data(), learning_rate); });
+
+        // Same seed and update sequence for every thread count: the results must agree.
+        auto const &out = model->predict(input.data());
+        float diff = 0;
+        for (std::size_t i = 0; i < W; ++i)
+        {
+            if (threads == thread_counts.front())
+                reference[i] = out[i];
+            diff = std::max(diff, fabsf(out[i] - reference[i]));
+        }
+
+        printf("%5zu %7zu %6zu  predict %9.1f us  train %9.1f us  predict %6.2f MAC/ns  max diff %g\n",
+               W, threads, split, predict_us, train_us, macs / (predict_us * 1000), diff);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t max_threads = argc > 1 ? atoi(argv[1]) : std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> thread_counts;
+    for (std::size_t t = 1; t <= max_threads; t *= 2)
+        thread_counts.push_back(t);
+
+    printf("%zu hardware threads, INTRA_OP_MIN_MACS %d\n", (std::size_t)std::thread::hardware_concurrency(), INTRA_OP_MIN_MACS);
+    printf("width threads split\n");
+    run<256>(thread_counts);
+    run<512>(thread_counts);
+    run<1024>(thread_counts);
+    run<2048>(thread_counts);
+    run<4096>(thread_counts);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#include "mlp.hpp"
+#include "iris.hpp"
+
+// The two inner loops of a perceptron layer, written once with pure_simd's eager
+// operators (each * and + builds a full temporary vector, sum() reduces through one
+// dependency chain) and once with lazy expressions (fused multiply-reduce with
+// independent accumulators, in-place multiply-add). Layer::feed/tune use the latter.
+//
+//   ./bench_kernels [iterations]
+
+namespace simd = pure_simd;
+
+template <std::size_t INPUTS, std::size_t OUTPUTS>
+struct kernels
+{
+    using row_t = simd::vector<float, INPUTS + 1>;
+
+    static inline simd::vector<row_t, OUTPUTS> weights;
+    static inline row_t inputs;
+    static inline float outputs[OUTPUTS];
+    static inline float delta_rate[OUTPUTS];
+
+    static void feed_eager()
+    {
+        for (std::size_t i = 0; i < OUTPUTS; ++i)
+            outputs[i] = simd::sum(inputs * weights[i], 0.0f);
+    }
+
+    static void feed_fused()
+    {
+        for (std::size_t i = 0; i < OUTPUTS; ++i)
+            outputs[i] = simd::sum(simd::lazy(inputs) * weights[i], 0.0f);
+    }
+
+    static void tune_eager()
+    {
+        for (std::size_t i = 0; i < OUTPUTS; ++i)
+            weights[i] = weights[i] + inputs * simd::scalar<row_t>(delta_rate[i]);
+    }
+
+    static void tune_fused()
+    {
+        for (std::size_t i = 0; i < OUTPUTS; ++i)
+            simd::assign(weights[i], simd::lazy(weights[i]) + inputs * simd::broadcast<row_t>(delta_rate[i]));
+    }
+
+    static double per_call(void (*kernel)(), int iterations)
+    {
+        return funcTime([&]
+                        {
+                            for (int k = 0; k < iterations; ++k)
+                            {
+                                kernel();
+                                // Keep the calls from being merged or hoisted.
+                                asm volatile("" ::: "memory");
+                            } }) / iterations;
+    }
+
+    static void run(int iterations)
+    {
+        for (std::size_t i = 0; i < OUTPUTS; ++i)
+        {
+            for (auto &w : weights[i])
+                w = meta_ai::fast_rand() / (float)FAST_RAND_MAX - 0.5f;
+            delta_rate[i] = 1e-6f;
+        }
+        for (auto &x : inputs)
+            x = meta_ai::fast_rand() / (float)FAST_RAND_MAX;
+
+        // Scale iterations so every size does about the same number of multiply-adds.
+        int const n = std::max(1, (int)(iterations * 64.0 * 64.0 / (INPUTS * OUTPUTS)));
+        double const fe = per_call(feed_eager, n), ff = per_call(feed_fused, n);
+        double const te = per_call(tune_eager, n), tf = per_call(tune_fused, n);
+
+        printf("%4zu x %-4zu feed %9.1f -> %9.1f ns (%4.1fx)   tune %9.1f -> %9.1f ns (%4.1fx)\n",
+               INPUTS, OUTPUTS, fe, ff, fe / ff, te, tf, te / tf);
+    }
+};
+
+int main(int argc, char **argv)
+{
+    int const iterations = argc > 1 ? atoi(argv[1]) : 200000;
+
+    printf("inputs x outputs, eager -> fused, ns per layer call\n");
+    kernels<4, 7>::run(iterations);
+    kernels<7, 3>::run(iterations);
+    kernels<16, 16>::run(iterations);
+    kernels<64, 64>::run(iterations);
+    kernels<128, 128>::run(iterations);
+    kernels<256, 256>::run(iterations);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+#include "lowrank.hpp"
+#include "iris.hpp"
+
+// Accuracy, memory and throughput of models factored by LowRankMLP, against the dense
+// MLP, at several energy thresholds and rank limits. Ranks are listed per layer; "-"
+// is a layer left dense because factoring it would not save multiplies.
+
+#define epochs 1000
+#define learning_rate 0.1
+#define rand_seed 0
+#define repeats 2000
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<128, 128>, mai::OUTPUT<out_cols>>;
+
+Model mlp;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+template <typename P>
+int correct_predictions(P &&predict)
+{
+    int correct = 0;
+    float prediction[out_cols];
+    for (int i = train_rows; i < rows; ++i)
+    {
+        int row = order[i];
+        predict(feat + row * cols, prediction);
+        correct += argmax_matches(prediction, label + row * out_cols);
+    }
+    return correct;
+}
+
+template <typename P>
+double predictions_per_second(P &&predict)
+{
+    float prediction[out_cols];
+    double const ns = funcTime([&]
+                               {
+                                   for (int r = 0; r < repeats; ++r)
+                                       for (int i = 0; i < rows; ++i)
+                                           predict(feat + i * cols, prediction); });
+    return repeats * rows / (ns / 1e9);
+}
+
+void report(double energy, std::size_t max_rank)
+{
+    mai::LowRankMLP<float> factored(mlp, {energy, max_rank});
+
+    char ranks[64] = "";
+    std::size_t len = 0;
+    for (std::size_t l = 0; l < factored.depth() && len < sizeof(ranks); ++l)
+    {
+        int const n = factored.rank(l) ? snprintf(ranks + len, sizeof(ranks) - len, "%s%zu", l ? "/" : "", factored.rank(l))
+                                       : snprintf(ranks + len, sizeof(ranks) - len, "%s-", l ? "/" : "");
+        len += n > 0 ? (std::size_t)n : 0;
+    }
+
+    double const kept = factored.depth() > 1 ? factored.energy(1) : factored.energy(0);
+    int const correct = correct_predictions([&](float const *in, float *out)
+                                            { factored.predict(in, out); });
+    double const rate = predictions_per_second([&](float const *in, float *out)
+                                               { factored.predict(in, out); });
+
+    std::size_t const dense = mai::checkpoint_weights<Model>();
+    printf("energy %5.3f  max rank %3zu  ranks %-10s  kept %5.1f%%  correct %2d/%d  %7zu bytes (%5.1f%%)  %6zu MACs (%5.1f%%)  %9.0f pred/s\n",
+           energy, max_rank, ranks, 100 * kept, correct, rows - train_rows, factored.bytes(),
+           100.0 * factored.bytes() / (dense * sizeof(float)), factored.flops(), 100.0 * factored.flops() / dense, rate);
+}
+
+int main(int argc, char **argv)
+{
+    srand(rand_seed);
+    mlp.xavier_init();
+    readIris(feat, label);
+
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    CHECK_TIME(
+        for (int i = 0; i < epochs; i++) {
+            shuffle(order, train_rows);
+            for (int j = 0; j < train_rows; j++)
+            {
+                int row = order[j];
+                mlp.train(feat + row * cols, label + row * out_cols, learning_rate);
+            }
+        })
+
+    int const dense_correct = correct_predictions([](float const *in, float *out)
+                                                  { mlp.predict_batch(in, 1, out); });
+    double const dense_rate = predictions_per_second([](float const *in, float *out)
+                                                     { mlp.predict_batch(in, 1, out); });
+    printf("dense                                                       correct %2d/%d  %7zu bytes           %6zu MACs           %9.0f pred/s\n",
+           dense_correct, rows - train_rows, mai::checkpoint_weights<Model>() * sizeof(float),
+           mai::checkpoint_weights<Model>(), dense_rate);
+
+    // "kept" is the energy of the middle 128 x 128 layer.
+    for (double energy : {0.999, 0.99, 0.95, 0.9, 0.8})
+        report(energy, 0);
+    for (std::size_t max_rank : {32, 16, 8, 4})
+        report(1, max_rank);
+
+    return EXIT_SUCCESS;
+}
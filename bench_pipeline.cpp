@@ -0,0 +1,94 @@
+#include "mlp.hpp"
+#include "pipeline.hpp"
+#include "iris.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Training throughput of deeper models: per-sample MLP::train against PipelineTrainer
+// with 1, 2, 4, ... stages. All pipeline runs start from the same weights and must end
+// with the same weights, whatever the number of stages.
+//
+//   ./bench_pipeline [max stages] [micro_batch] [micro_batches]
+
+namespace mai = meta_ai;
+
+#define learning_rate 0.002f
+
+template <typename Model>
+float max_weight_difference(Model const &a, Model const &b)
+{
+    std::vector<float> wa, wb;
+    a.for_each_layer([&](auto const &layer)
+                     {
+                         for (auto &&row : layer.get_weights())
+                             for (std::size_t k = 0; k <= layer.inputs(); ++k)
+                                 wa.push_back(row[k]); });
+    b.for_each_layer([&](auto const &layer)
+                     {
+                         for (auto &&row : layer.get_weights())
+                             for (std::size_t k = 0; k <= layer.inputs(); ++k)
+                                 wb.push_back(row[k]); });
+    float diff = 0;
+    for (std::size_t i = 0; i < wa.size(); ++i)
+        diff = std::max(diff, fabsf(wa[i] - wb[i]));
+    return diff;
+}
+
+template <typename Model>
+void run(char const *name, std::size_t max_stages, std::size_t micro_batch, std::size_t micro_batches)
+{
+    std::size_t const samples = 4096;
+    std::vector<float> input(samples * Model::inputs()), answer(samples * Model::outputs());
+    for (auto &x : input)
+        x = mai::fast_rand() / (float)FAST_RAND_MAX;
+    for (std::size_t s = 0; s < samples; ++s)
+        answer[s * Model::outputs() + s % Model::outputs()] = 1;
+
+    mai::fast_srand(7);
+    auto const initial = std::make_unique<Model>();
+    initial->xavier_init();
+
+    auto serial = std::make_unique<Model>(*initial);
+    double const serial_ns = funcTime([&]
+                                      {
+                                          for (std::size_t s = 0; s < samples; ++s)
+                                              serial->train(input.data() + s * Model::inputs(), answer.data() + s * Model::outputs(), learning_rate); });
+    printf("%-22s serial MLP::train              %9.0f samples/s\n", name, samples / serial_ns * 1e9);
+
+    std::unique_ptr<Model> reference;
+    for (std::size_t stages = 1; stages <= std::min(max_stages, Model::depth()); stages *= 2)
+    {
+        auto model = std::make_unique<Model>(*initial);
+        double ns;
+        std::string cut;
+        {
+            mai::PipelineTrainer<Model> trainer(*model, stages, micro_batch, micro_batches);
+            ns = funcTime([&]
+                          { trainer.train(input.data(), answer.data(), samples, learning_rate); });
+            for (std::size_t s = 0; s < trainer.n_stages(); ++s)
+            {
+                auto const layers = trainer.stage_layers(s);
+                cut += " " + std::to_string(layers.first) + "-" + std::to_string(layers.second);
+            }
+        }
+        if (!reference)
+            reference = std::make_unique<Model>(*model);
+        printf("%-22s pipeline %zu stage(s) %-16s %9.0f samples/s  max weight diff vs 1 stage %g\n",
+               "", stages, cut.c_str(), samples / ns * 1e9, max_weight_difference(*model, *reference));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t const max_stages = argc > 1 ? atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    std::size_t const micro_batch = argc > 2 ? atoi(argv[2]) : 8;
+    std::size_t const micro_batches = argc > 3 ? atoi(argv[3]) : 8;
+
+    printf("%u hardware threads, mini-batch %zu x %zu\n", std::thread::hardware_concurrency(), micro_batches, micro_batch);
+    run<mai::MLP<float, mai::INPUT<64>, mai::HIDDEN<128, 128, 128, 128>, mai::OUTPUT<10>>>("64-128x4-10", max_stages, micro_batch, micro_batches);
+    run<mai::MLP<float, mai::INPUT<256>, mai::HIDDEN<256, 256, 256, 256, 256, 256>, mai::OUTPUT<16>>>("256-256x6-16", max_stages, micro_batch, micro_batches);
+    run<mai::MLP<float, mai::INPUT<512>, mai::HIDDEN<1024, 1024, 1024>, mai::OUTPUT<10>>>("512-1024x3-10 (wide)", max_stages, micro_batch, micro_batches);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+#include "registry.hpp"
+#include "streaming.hpp"
+#include "iris.hpp"
+#include <sys/stat.h>
+#include <memory>
+#include <vector>
+
+// Thousands of per-customer models behind one ModelRegistry and RegistryServer. Writes
+// n_models checkpoints of three topologies into registry_models/, then clients send
+// requests with Zipf-distributed model ids, so a few models are hot and most are cold.
+// Reports request throughput, cache hit rate, evictions and model load latency.
+//
+//   ./bench_registry [n_models] [budget MiB] [clients] [requests per client]
+
+namespace mai = meta_ai;
+
+#define models_dir "registry_models"
+
+using Small = mai::MLP<float, mai::INPUT<16>, mai::HIDDEN<16>, mai::OUTPUT<4>>;
+using Medium = mai::MLP<float, mai::INPUT<16>, mai::HIDDEN<64, 32>, mai::OUTPUT<4>>;
+using Large = mai::MLP<float, mai::INPUT<16>, mai::HIDDEN<256, 128>, mai::OUTPUT<4>>;
+
+template <typename Model>
+void write_model(std::string const &path)
+{
+    auto model = std::make_unique<Model>();
+    model->xavier_init();
+    mai::save_checkpoint(*model, path.c_str());
+}
+
+// The mapped model must agree with the MLP it was saved from.
+template <typename Model>
+float check_against_mlp(mai::ModelRegistry<float> &registry, std::string const &id)
+{
+    auto model = std::make_unique<Model>();
+    mai::load_checkpoint(*model, (std::string(models_dir "/") + id + ".ckpt").c_str());
+    std::vector<float> input(8 * Model::inputs()), expected(8 * Model::outputs()), got(8 * Model::outputs());
+    for (auto &x : input)
+        x = mai::fast_rand() / (float)FAST_RAND_MAX;
+    model->predict_batch(input.data(), 8, expected.data());
+    registry.get(id)->predict_batch(input.data(), 8, got.data());
+    float diff = 0;
+    for (std::size_t i = 0; i < got.size(); ++i)
+        diff = std::max(diff, fabsf(got[i] - expected[i]));
+    return diff;
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t const n_models = argc > 1 ? atoi(argv[1]) : 2000;
+    std::size_t const budget = (argc > 2 ? atof(argv[2]) : 8) * (1 << 20);
+    std::size_t const clients = argc > 3 ? atoi(argv[3]) : 8;
+    std::size_t const per_client = argc > 4 ? atoi(argv[4]) : 20000;
+
+    mkdir(models_dir, 0755);
+    double const write_ms = funcTime([&]
+                                     {
+                                         for (std::size_t m = 0; m < n_models; ++m)
+                                         {
+                                             std::string const path = std::string(models_dir "/") + std::to_string(m) + ".ckpt";
+                                             if (m % 10 == 0)
+                                                 write_model<Large>(path);
+                                             else if (m % 3 == 0)
+                                                 write_model<Medium>(path);
+                                             else
+                                                 write_model<Small>(path);
+                                         } }) / 1e6;
+    printf("wrote %zu models in %.0f ms; budget %.1f MiB, %zu clients x %zu requests\n", n_models, write_ms, budget / 1048576.0, clients, per_client);
+
+    mai::ModelRegistry<float> registry(mai::ModelRegistry<float>::directory(models_dir), budget);
+    printf("mapped vs MLP max difference: %g %g %g\n",
+           check_against_mlp<Large>(registry, "0"), check_against_mlp<Medium>(registry, "3"), check_against_mlp<Small>(registry, "1"));
+
+    // Zipf(1.1) over model ids.
+    std::vector<double> cdf(n_models);
+    double total = 0;
+    for (std::size_t m = 0; m < n_models; ++m)
+        cdf[m] = total += 1 / pow(m + 1.0, 1.1);
+    for (auto &c : cdf)
+        c /= total;
+
+    mai::RegistryServer<float> server(registry, 2, 64, std::chrono::microseconds(50));
+    std::atomic<uint64_t> failed{0};
+    double const serve_ms = funcTime([&]
+                                     {
+                                         std::vector<std::thread> threads;
+                                         for (std::size_t c = 0; c < clients; ++c)
+                                             threads.emplace_back([&, c]
+                                                                  {
+                                                                      uint64_t rng = 0x9E3779B97F4A7C15ull * (c + 1);
+                                                                      float input[16];
+                                                                      for (auto &x : input)
+                                                                          x = 0.5f;
+                                                                      // A few requests in flight per client, so the server can batch.
+                                                                      std::vector<std::future<bool>> pending;
+                                                                      std::vector<float> outputs(4 * 4);
+                                                                      for (std::size_t r = 0; r < per_client; ++r)
+                                                                      {
+                                                                          double const u = (mai::streaming::detail::xorshift(rng) >> 11) * (1.0 / 9007199254740992.0);
+                                                                          std::size_t const m = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+                                                                          pending.push_back(server.submit(std::to_string(std::min(m, n_models - 1)), input, &outputs[4 * pending.size()]));
+                                                                          if (pending.size() == 4 || r + 1 == per_client)
+                                                                          {
+                                                                              for (auto &f : pending)
+                                                                                  failed += !f.get();
+                                                                              pending.clear();
+                                                                          }
+                                                                      } });
+                                         for (auto &t : threads)
+                                             t.join(); }) / 1e6;
+
+    auto const s = registry.stats();
+    std::size_t const requests = clients * per_client;
+    printf("%zu requests in %.0f ms: %.0f requests/s, %.1f requests per predict_batch, %lu failed\n",
+           requests, serve_ms, requests / serve_ms * 1000, server.mean_group_size(), (unsigned long)failed);
+    printf("cache: hit rate %.2f%% (%lu hits, %lu misses), %lu evictions, %zu models / %.1f MiB resident\n",
+           100 * s.hit_rate(), (unsigned long)s.hits, (unsigned long)s.misses, (unsigned long)s.evictions,
+           s.resident_models, s.resident_bytes / 1048576.0);
+    printf("load latency: mean %.1f us, p50 <= %.1f us, p99 <= %.1f us, max %.1f us\n",
+           s.load_us_mean, s.load_us_p50, s.load_us_p99, s.load_us_max);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+#include "mlp.hpp"
+#include "sampling.hpp"
+#include "iris.hpp"
+
+// Time to accuracy of example.cpp's model and loop, rows drawn by uniform shuffling
+// against loss-aware importance sampling (ImportanceSampler, sampling.hpp), which also
+// draws fewer rows per epoch. A held-out row counts as correct, as in example.cpp, when
+// every output is within 0.1 of the answer; the clock stops while accuracy is measured.
+//
+// usage: bench_sampling [target correct = 43]
+
+#define epochs 100000
+#define learning_rate 0.1
+#define rand_seed 0
+#define check_every 500 // epochs' worth of train calls (train_rows each)
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>>;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+int held_out_correct(Model &mlp)
+{
+    int correct = 0;
+    for (int i = train_rows; i < rows; ++i)
+    {
+        int row = order[i];
+        auto const &prediction = mlp.predict(feat + row * cols);
+        bool ok = true;
+        for (int k = 0; k < out_cols; ++k)
+            ok &= fabs(prediction[k] - label[row * out_cols + k]) < 0.1;
+        correct += ok;
+    }
+    return correct;
+}
+
+// Runs epoch(mlp) until target is reached or the budget of train calls is spent.
+template <typename Epoch>
+void run(char const *name, int target, std::size_t calls_per_epoch, Epoch &&epoch)
+{
+    srand(rand_seed);
+    mai::fast_srand(rand_seed);
+    Model mlp;
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    std::size_t const budget = (std::size_t)epochs * train_rows;
+    std::size_t const check = (std::size_t)check_every * train_rows;
+    std::size_t calls = 0, next_check = check;
+    double ns = 0;
+    int correct = 0;
+    while (calls < budget)
+    {
+        auto const t0 = timeNow();
+        while (calls < next_check)
+        {
+            epoch(mlp);
+            calls += calls_per_epoch;
+        }
+        ns += duration(timeNow() - t0);
+        next_check += check;
+        if ((correct = held_out_correct(mlp)) >= target)
+            break;
+    }
+
+    printf("%-24s %s %2d/%d after %9zu train calls (%6zu epochs of %3zu)  %8.1f ms\n", name,
+           correct >= target ? "reached" : "stopped", correct, rows - train_rows, calls, calls / calls_per_epoch,
+           calls_per_epoch, ns / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    int const target = argc > 1 ? atoi(argv[1]) : 43;
+    readIris(feat, label);
+
+    run("uniform shuffle", target, train_rows, [](Model &mlp)
+        {
+            shuffle(order, train_rows);
+            for (int j = 0; j < train_rows; j++)
+            {
+                int row = order[j];
+                mlp.train(feat + row * cols, label + row * out_cols, learning_rate);
+            } });
+
+    for (double fraction : {1.0, 0.5, 0.25})
+    {
+        std::size_t const draws = (std::size_t)(fraction * train_rows);
+        mai::ImportanceSampler sampler(train_rows, {}, rand_seed + 1);
+        char name[64];
+        snprintf(name, sizeof(name), "importance, %3.0f%% rows", 100 * fraction);
+        run(name, target, draws, [&](Model &mlp)
+            {
+                for (std::size_t j = 0; j < draws; j++)
+                {
+                    mai::weighted_row const pick = sampler.next();
+                    int row = order[pick.row];
+                    float const loss = mlp.train(feat + row * cols, label + row * out_cols, learning_rate * pick.weight);
+                    sampler.update(pick.row, loss);
+                } });
+    }
+
+    return EXIT_SUCCESS;
+}
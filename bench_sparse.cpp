@@ -0,0 +1,107 @@
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+#include "sparse.hpp"
+#include "iris.hpp"
+
+// Accuracy, memory and throughput of pruned models served by SparseMLP, against the
+// dense MLP, for unstructured, 2:4 and 4-wide block pruning at several sparsities.
+// 2:4 pruning never empties a 4-wide block, so it only pays off with a 2:4 kernel.
+
+#define epochs 1000
+#define learning_rate 0.1
+#define rand_seed 0
+#define repeats 2000
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<64, 64>, mai::OUTPUT<out_cols>>;
+
+Model mlp;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+template <typename P>
+int correct_predictions(P &&predict)
+{
+    int correct = 0;
+    float prediction[out_cols];
+    for (int i = train_rows; i < rows; ++i)
+    {
+        int row = order[i];
+        predict(feat + row * cols, prediction);
+        correct += argmax_matches(prediction, label + row * out_cols);
+    }
+    return correct;
+}
+
+template <typename P>
+double predictions_per_second(P &&predict)
+{
+    float prediction[out_cols];
+    double const ns = funcTime([&]
+                               {
+                                   for (int r = 0; r < repeats; ++r)
+                                       for (int i = 0; i < rows; ++i)
+                                           predict(feat + i * cols, prediction); });
+    return repeats * rows / (ns / 1e9);
+}
+
+template <typename Prune>
+void report(char const *method, double sparsity, Prune &&prune)
+{
+    Model pruned = mlp;
+    prune(pruned, sparsity);
+    mai::SparseMLP<float> sparse(pruned);
+
+    int const correct = correct_predictions([&](float const *in, float *out)
+                                            { sparse.predict(in, out); });
+    double const rate = predictions_per_second([&](float const *in, float *out)
+                                               { sparse.predict(in, out); });
+
+    printf("%-8s %5.0f%%  %5.1f%% zero  correct %2d/%d  %7zu bytes (%5.1f%%)  %6zu MACs  %9.0f pred/s\n",
+           method, 100 * sparsity, 100 * mai::weight_sparsity(pruned), correct, rows - train_rows,
+           sparse.bytes(), 100.0 * sparse.bytes() / (mai::checkpoint_weights<Model>() * sizeof(float)),
+           sparse.flops(), rate);
+}
+
+int main(int argc, char **argv)
+{
+    srand(rand_seed);
+    mlp.xavier_init();
+    readIris(feat, label);
+
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    CHECK_TIME(
+        for (int i = 0; i < epochs; i++) {
+            shuffle(order, train_rows);
+            for (int j = 0; j < train_rows; j++)
+            {
+                int row = order[j];
+                mlp.train(feat + row * cols, label + row * out_cols, learning_rate);
+            }
+        })
+
+    int const dense_correct = correct_predictions([](float const *in, float *out)
+                                                  { mlp.predict_batch(in, 1, out); });
+    double const dense_rate = predictions_per_second([](float const *in, float *out)
+                                                     { mlp.predict_batch(in, 1, out); });
+    printf("dense            correct %2d/%d  %7zu bytes           %6zu MACs  %9.0f pred/s\n",
+           dense_correct, rows - train_rows, mai::checkpoint_weights<Model>() * sizeof(float),
+           mai::checkpoint_weights<Model>(), dense_rate);
+
+    for (double sparsity : {0.0, 0.5, 0.75, 0.9, 0.95})
+        report("weights", sparsity, [](Model &m, double s)
+               { mai::prune_magnitude(m, s); });
+    report("2:4", 0.5, [](Model &m, double)
+           { mai::prune_n_of_m(m, 2, 4); });
+    for (double sparsity : {0.5, 0.75, 0.9, 0.95})
+        report("blocks", sparsity, [](Model &m, double s)
+               { mai::prune_blocks(m, s); });
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+#include "mlp.hpp"
+#include "iris.hpp"
+#include <memory>
+#include <vector>
+
+// Throughput of INPUT<W> -> HIDDEN<W> -> OUTPUT<W> models as W grows past
+// WIDE_LAYER_THRESHOLD, where layers switch from the unrolled pure_simd kernels to
+// the tiled, heap-backed WideLayer. Reported in multiply-adds per nanosecond, so a flat
+// column means throughput holds up with width.
+//
+//   ./bench_wide [work]     work scales the number of samples per width (default 1)
+
+namespace mai = meta_ai;
+
+#define learning_rate 0.01f
+
+template <std::size_t W>
+void run(double work)
+{
+    using Model = mai::MLP<float, mai::INPUT<W>, mai::HIDDEN<W>, mai::OUTPUT<W>>;
+    constexpr std::size_t BATCH = Model::BATCH;
+
+    auto model = std::make_unique<Model>();
+    model->xavier_init();
+
+    std::vector<float> input(BATCH * W), answer(W), output(BATCH * W);
+    for (auto &x : input)
+        x = mai::fast_rand() / (float)FAST_RAND_MAX;
+    for (std::size_t i = 0; i < W; ++i)
+        answer[i] = i % 2;
+
+    // Two W x (W + 1) layers; training does the forward pass, the deltas and the update.
+    double const macs = 2.0 * W * (W + 1);
+    int const samples = std::max(4, (int)(work * 2e9 / (3 * macs)));
+
+    double const train_ns = funcTime([&]
+                                     {
+                                         for (int s = 0; s < samples; ++s)
+                                             model->train(input.data() + (s % BATCH) * W, answer.data(), learning_rate); });
+    double const predict_ns = funcTime([&]
+                                       {
+                                           for (int s = 0; s < samples; ++s)
+                                               model->predict(input.data() + (s % BATCH) * W); });
+    int const batches = std::max(1, samples / (int)BATCH);
+    double const batch_ns = funcTime([&]
+                                     {
+                                         for (int b = 0; b < batches; ++b)
+                                             model->predict_batch(input.data(), BATCH, output.data()); });
+
+    printf("%5zu %-6s %8zu B  train %6.2f  predict %6.2f  predict_batch %6.2f MAC/ns  (%9.1f us/sample trained)\n",
+           W, mai::is_wide_layer<W, W>() ? "wide" : "simd", sizeof(Model),
+           3 * macs * samples / train_ns, macs * samples / predict_ns, macs * batches * BATCH / batch_ns,
+           train_ns / samples / 1000);
+}
+
+int main(int argc, char **argv)
+{
+    double const work = argc > 1 ? atof(argv[1]) : 1;
+
+    printf("width  path   sizeof(MLP)\n");
+    run<64>(work);
+    run<128>(work);
+    run<256>(work);
+    run<512>(work);
+    run<1024>(work);
+    run<2048>(work);
+    run<4096>(work);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,293 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Weight checkpoints for MLP-like models (anything with topology() and for_each_layer()).
+//
+// File layout: a 128-byte checkpoint_header, then for every perceptron layer its
+// OUTPUTS rows of INPUTS + 1 weights (the last one is the bias), row-major.
+// The payload starts 64-byte aligned so the file can also be mapped and used in place.
+
+namespace meta_ai
+{
+    struct checkpoint_header
+    {
+        static constexpr std::size_t MAX_WIDTHS = 22;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t float_size;
+        uint32_t n_widths;
+        uint32_t reserved;
+        uint64_t step;
+        uint64_t payload_bytes;
+        uint32_t widths[MAX_WIDTHS];
+    };
+
+    static_assert(sizeof(checkpoint_header) == 128, "");
+
+    constexpr char CHECKPOINT_MAGIC[8] = {'M', 'A', 'I', 'C', 'K', 'P', 'T', 0};
+
+    template <typename Model>
+    constexpr std::size_t checkpoint_weights()
+    {
+        auto const widths = Model::topology();
+        std::size_t n = 0;
+        for (std::size_t l = 0; l + 1 < widths.size(); ++l)
+        {
+            n += (widths[l] + 1) * widths[l + 1];
+        }
+        return n;
+    }
+
+    // Writes path atomically: a temporary file is written and fsync'ed, renamed over
+    // path, and the directory is fsync'ed so the rename itself is durable.
+    inline bool write_file_atomically(char const *path, void const *head, std::size_t head_size, void const *body, std::size_t body_size)
+    {
+        std::string const tmp = std::string(path) + ".tmp";
+
+        int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+
+        auto write_all = [fd](void const *buf, std::size_t n)
+        {
+            char const *p = (char const *)buf;
+            while (n > 0)
+            {
+                ssize_t r = write(fd, p, n);
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r <= 0)
+                    return false;
+                p += r;
+                n -= (std::size_t)r;
+            }
+            return true;
+        };
+
+        bool ok = write_all(head, head_size) && write_all(body, body_size) && fsync(fd) == 0;
+        ok = close(fd) == 0 && ok;
+        if (!ok || rename(tmp.c_str(), path) != 0)
+        {
+            unlink(tmp.c_str());
+            return false;
+        }
+
+        std::string dir(path);
+        auto const slash = dir.rfind('/');
+        dir = slash == std::string::npos ? "." : dir.substr(0, slash + 1);
+        int dfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dfd >= 0)
+        {
+            fsync(dfd);
+            close(dfd);
+        }
+        return true;
+    }
+
+    template <typename Model>
+    checkpoint_header make_checkpoint_header(uint64_t step)
+    {
+        using float_t = typename Model::value_type;
+        auto const widths = Model::topology();
+        static_assert(widths.size() <= checkpoint_header::MAX_WIDTHS, "too many layers for the checkpoint header");
+
+        checkpoint_header header = {};
+        memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+        header.version = 1;
+        header.float_size = sizeof(float_t);
+        header.n_widths = widths.size();
+        header.step = step;
+        header.payload_bytes = checkpoint_weights<Model>() * sizeof(float_t);
+        for (std::size_t l = 0; l < widths.size(); ++l)
+        {
+            header.widths[l] = widths[l];
+        }
+        return header;
+    }
+
+    template <typename Model, typename float_t>
+    void pack_weights(Model const &model, float_t *dst)
+    {
+        model.for_each_layer([&](auto const &layer)
+                             {
+                                 for (std::size_t i = 0; i < layer.size(); ++i)
+                                 {
+                                     auto const &row = layer.get_weights().begin()[i];
+                                     for (std::size_t j = 0; j < layer.inputs() + 1; ++j)
+                                     {
+                                         *dst++ = row.begin()[j];
+                                     }
+                                 } });
+    }
+
+    template <typename Model, typename float_t>
+    void unpack_weights(Model &model, float_t const *src)
+    {
+        model.for_each_layer([&](auto &layer)
+                             {
+                                 for (std::size_t i = 0; i < layer.size(); ++i)
+                                 {
+                                     auto &&row = layer.get_weights().begin()[i];
+                                     for (std::size_t j = 0; j < layer.inputs() + 1; ++j)
+                                     {
+                                         row.begin()[j] = *src++;
+                                     }
+                                 } });
+    }
+
+    template <typename Model>
+    bool save_checkpoint(Model const &model, char const *path, uint64_t step = 0)
+    {
+        auto const header = make_checkpoint_header<Model>(step);
+        std::vector<typename Model::value_type> payload(checkpoint_weights<Model>());
+        pack_weights(model, payload.data());
+        return write_file_atomically(path, &header, sizeof(header), payload.data(), header.payload_bytes);
+    }
+
+    // Fails without touching the model if the file is missing, truncated or was saved
+    // from a different topology or float type.
+    template <typename Model>
+    bool load_checkpoint(Model &model, char const *path, uint64_t *step = nullptr)
+    {
+        auto const expected = make_checkpoint_header<Model>(0);
+
+        FILE *file = fopen(path, "rb");
+        if (!file)
+            return false;
+
+        checkpoint_header header;
+        std::vector<typename Model::value_type> payload(checkpoint_weights<Model>());
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+                  memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+                  header.version == expected.version &&
+                  header.float_size == expected.float_size &&
+                  header.n_widths == expected.n_widths &&
+                  memcmp(header.widths, expected.widths, sizeof(header.widths)) == 0 &&
+                  header.payload_bytes == expected.payload_bytes &&
+                  fread(payload.data(), 1, header.payload_bytes, file) == header.payload_bytes;
+        fclose(file);
+        if (!ok)
+            return false;
+
+        unpack_weights(model, payload.data());
+        if (step)
+            *step = header.step;
+        return true;
+    }
+
+    // Background checkpointing. request() packs the model's weights into a back buffer and
+    // returns; a writer thread swaps it with the front buffer and saves it while training
+    // goes on. If a newer snapshot is requested before the previous one was picked up, the
+    // newer one replaces it, so the trainer never waits on the disk. The buffers are plain
+    // weight arrays: no Model is built, so no initial weights are drawn from fast_rand.
+    template <typename Model>
+    class Checkpointer
+    {
+        using float_t = typename Model::value_type;
+
+        std::string path;
+        std::vector<float_t> buffers[2];
+        int back = 0;
+        uint64_t back_step = 0;
+        bool pending = false;
+        bool writing = false;
+        bool stopping = false;
+
+        unsigned long written = 0;
+        unsigned long failed = 0;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::thread writer;
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            for (;;)
+            {
+                wake.wait(lk, [&]
+                          { return pending || stopping; });
+                if (!pending)
+                    break;
+
+                int const front = back;
+                uint64_t const step = back_step;
+                back ^= 1;
+                pending = false;
+                writing = true;
+
+                lk.unlock();
+                auto const header = make_checkpoint_header<Model>(step);
+                bool const ok = write_file_atomically(path.c_str(), &header, sizeof(header), buffers[front].data(), header.payload_bytes);
+                lk.lock();
+
+                writing = false;
+                ok ? ++written : ++failed;
+                idle.notify_all();
+            }
+        }
+
+    public:
+        explicit Checkpointer(char const *path)
+            : path(path), buffers{std::vector<float_t>(checkpoint_weights<Model>()), std::vector<float_t>(checkpoint_weights<Model>())}
+        {
+            writer = std::thread(&Checkpointer::run, this);
+        }
+
+        // Writes the last requested snapshot, if any, before returning.
+        ~Checkpointer()
+        {
+            {
+                std::lock_guard<std::mutex> lk(lock);
+                stopping = true;
+            }
+            wake.notify_one();
+            writer.join();
+        }
+
+        void request(Model const &model, uint64_t step)
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            pack_weights(model, buffers[back].data());
+            back_step = step;
+            pending = true;
+            wake.notify_one();
+        }
+
+        // Blocks until every requested snapshot is on disk.
+        void wait()
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            idle.wait(lk, [&]
+                      { return !pending && !writing; });
+        }
+
+        unsigned long checkpoints_written()
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            return written;
+        }
+
+        unsigned long checkpoints_failed()
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            return failed;
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef __CODEGEN_H__
+#define __CODEGEN_H__
+
+#include <stdio.h>
+#include <string>
+#include <type_traits>
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+
+// Ahead-of-time export of a trained MLP as a self-contained C++ header.
+//
+// export_header() writes every perceptron layer as an `alignas(64) constexpr` array of
+// hex-float literals (bit-exact, no decimal round trip) and a `predict` that evaluates
+// the network with the weights as compile-time constants. The header only needs <cmath>:
+//
+//     namespace iris_model
+//     {
+//         constexpr std::size_t inputs = 4, outputs = 3;
+//         alignas(64) constexpr float layer0[7][5] = {...};
+//         ...
+//         inline void predict(float const *input, float *output);
+//     }
+//
+// Layers with up to max_unrolled weights are emitted as straight-line code, one sum per
+// neuron with the exact-zero weights (e.g. after pruning) left out, which the compiler is
+// free to constant-fold and schedule. Bigger layers are emitted as loops over their array
+// so the header stays compilable.
+
+namespace meta_ai
+{
+    namespace detail
+    {
+        template <typename float_t>
+        std::string float_literal(float_t x)
+        {
+            char text[64];
+            snprintf(text, sizeof(text), "%a%s", (double)x, std::is_same<float_t, float>::value ? "f" : "");
+            return text;
+        }
+    };
+
+    template <typename Model>
+    bool export_header(Model const &model, char const *path, char const *name, std::size_t max_unrolled = 4096)
+    {
+        using float_t = typename Model::value_type;
+        static_assert(std::is_same<float_t, float>::value || std::is_same<float_t, double>::value,
+                      "export_header writes float or double literals");
+        char const *type = std::is_same<float_t, float>::value ? "float" : "double";
+
+        std::string text;
+        auto const line = [&](std::string const &s)
+        { text += s + "\n"; };
+
+        line("// Generated by meta_ai::export_header. Do not edit.");
+        line("#pragma once");
+        line("");
+        line("#include <cmath>");
+        line("#include <cstddef>");
+        line("");
+        line(std::string("namespace ") + name);
+        line("{");
+        line("    constexpr std::size_t inputs = " + std::to_string(Model::inputs()) + ", outputs = " + std::to_string(Model::outputs()) + ";");
+
+        // Weight arrays, row i = neuron i, lane INPUTS = bias.
+        std::size_t index = 0;
+        model.for_each_layer([&](auto const &layer)
+                             {
+                                 std::size_t const n_in = layer.inputs(), n_out = layer.size();
+                                 line("");
+                                 line("    alignas(64) constexpr " + std::string(type) + " layer" + std::to_string(index++) + "[" +
+                                      std::to_string(n_out) + "][" + std::to_string(n_in + 1) + "] = {");
+                                 for (std::size_t i = 0; i < n_out; ++i)
+                                 {
+                                     auto const *row = layer.get_weights().begin()[i].begin();
+                                     std::string values = "        {";
+                                     for (std::size_t k = 0; k <= n_in; ++k)
+                                         values += (k ? ", " : "") + detail::float_literal(row[k]);
+                                     line(values + "},");
+                                 }
+                                 line("    };");
+                             });
+
+        line("");
+        line(std::string("    inline ") + type + " sigmoid(" + type + " x) { return 1 / (1 + std::exp(-x)); }");
+        line("");
+        line(std::string("    inline void predict(") + type + " const *input, " + type + " *output)");
+        line("    {");
+
+        // a<l>_<i> holds neuron i of layer l; the input is a<-1>, spelled input[k].
+        index = 0;
+        std::size_t const last = Model::topology().size() - 2;
+        model.for_each_layer([&](auto const &layer)
+                             {
+                                 std::size_t const n_in = layer.inputs(), n_out = layer.size(), l = index++;
+                                 std::string const weights = "layer" + std::to_string(l);
+                                 std::string const in = l == 0 ? "input" : "a" + std::to_string(l - 1);
+                                 std::string const out = l == last ? "output" : "a" + std::to_string(l);
+
+                                 if (n_out * (n_in + 1) > max_unrolled)
+                                 {
+                                     if (l != last)
+                                         line("        " + std::string(type) + " " + out + "[" + std::to_string(n_out) + "];");
+                                     line("        for (std::size_t i = 0; i < " + std::to_string(n_out) + "; ++i)");
+                                     line("        {");
+                                     line("            " + std::string(type) + " sum = " + weights + "[i][" + std::to_string(n_in) + "];");
+                                     line("            for (std::size_t k = 0; k < " + std::to_string(n_in) + "; ++k)");
+                                     line("                sum += " + weights + "[i][k] * " + in + "[k];");
+                                     line("            " + out + "[i] = sigmoid(sum);");
+                                     line("        }");
+                                     return;
+                                 }
+
+                                 if (l != last)
+                                     line("        " + std::string(type) + " " + out + "[" + std::to_string(n_out) + "];");
+                                 for (std::size_t i = 0; i < n_out; ++i)
+                                 {
+                                     auto const *row = layer.get_weights().begin()[i].begin();
+                                     std::string const w = weights + "[" + std::to_string(i) + "]";
+                                     std::string sum = w + "[" + std::to_string(n_in) + "]";
+                                     for (std::size_t k = 0; k < n_in; ++k)
+                                     {
+                                         if (row[k] != 0)
+                                             sum += " + " + w + "[" + std::to_string(k) + "] * " + in + "[" + std::to_string(k) + "]";
+                                     }
+                                     line("        " + out + "[" + std::to_string(i) + "] = sigmoid(" + sum + ");");
+                                 }
+                             });
+
+        line("    }");
+        line("};");
+        return write_file_atomically(path, text.data(), text.size(), nullptr, 0);
+    }
+};
+
+#endif
@@ -0,0 +1,757 @@
+#ifndef __DISTRIBUTED_H__
+#define __DISTRIBUTED_H__
+
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <immintrin.h>
+#include "mlp.hpp"
+#include "serving.hpp"
+#include "streaming.hpp"
+
+// Multi-process data-parallel training.
+//
+// Every rank is a process with its own replica of the model and its own shard of the
+// data. The ranks form a ring: each one sends to rank + 1 and receives from rank - 1.
+// RingAllReduce sums a float buffer over all ranks in 2 (N - 1) steps, first a
+// reduce-scatter, after which every rank holds the total of one N-th of the buffer, then
+// an all-gather of those totals; each rank sends and receives 2 (N - 1) / N of the
+// buffer, however many ranks there are. With fp16 the chunks travel as half floats and
+// are added in single precision; a chunk's owner rounds its total through half precision
+// too, so the replicas still end up bit-identical.
+//
+// A link to the next rank is a TCP connection, or, when both ranks are on the same host,
+// a single-producer single-consumer byte ring in a shared memory file under /dev/shm.
+// Sending and receiving go on together in one non-blocking loop, so a ring of full
+// socket buffers cannot deadlock. A rank that dies mid-step makes the TCP neighbours fail
+// with an error; shared-memory neighbours notice that its process is gone. A neighbour
+// that hangs, or a dead one that has not been reaped yet, fails the step once nothing has
+// moved for config.timeout.
+//
+// DataParallelTrainer runs mini-batch steps through the layers' feed_batch and
+// backward_batch, averages the gradients over the ranks with the ring and applies them on
+// every replica. A rank's gradient is the sum over its batch, as in backward_batch, so
+// the step at a given rate does not grow with the number of ranks: N ranks with batch b
+// at rate r make the update of one process with batch N * b at rate r / N, up to the
+// order in which the gradients are summed.
+
+namespace meta_ai
+{
+    namespace distributed
+    {
+        enum class transport
+        {
+            tcp,
+            shm,       // every rank on this host
+            automatic, // shared memory to a next rank with the same host, TCP otherwise
+        };
+
+        struct ring_config
+        {
+            unsigned rank = 0;
+            unsigned world = 1;
+            transport kind = transport::automatic;
+            std::vector<std::string> hosts; // IPv4 address of every rank; empty: all on 127.0.0.1
+            uint16_t port = 47000;          // rank r listens on port + r
+            std::string shm_name = "mai_ring"; // unique per job: /dev/shm/<shm_name>.<rank>
+            bool fp16 = false;
+            std::chrono::milliseconds timeout{30000}; // for the ring to form, and for a step without progress
+        };
+
+        namespace detail
+        {
+            inline uint16_t half_from_float(float f)
+            {
+#ifdef __F16C__
+                return _cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+                uint32_t bits;
+                memcpy(&bits, &f, sizeof(bits));
+                uint32_t const sign = (bits >> 16) & 0x8000, exponent = (bits >> 23) & 0xFF;
+                uint32_t mantissa = bits & 0x7FFFFF;
+                if (exponent == 0xFF)
+                    return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+                int const e = (int)exponent - 127 + 15;
+                if (e >= 31)
+                    return sign | 0x7C00;
+                if (e <= 0)
+                {
+                    if (e < -10)
+                        return sign;
+                    mantissa |= 0x800000;
+                    uint32_t const shift = 14 - e, rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+                    uint32_t half = mantissa >> shift;
+                    half += rest > halfway || (rest == halfway && (half & 1));
+                    return sign | half;
+                }
+                uint32_t half = (uint32_t)e << 10 | mantissa >> 13;
+                uint32_t const rest = mantissa & 0x1FFF;
+                half += rest > 0x1000 || (rest == 0x1000 && (half & 1)); // may carry into the exponent
+                return sign | half;
+#endif
+            }
+
+            inline float float_from_half(uint16_t h)
+            {
+#ifdef __F16C__
+                return _cvtsh_ss(h);
+#else
+                uint32_t const sign = (uint32_t)(h & 0x8000) << 16;
+                uint32_t exponent = (h >> 10) & 0x1F, mantissa = h & 0x3FF, bits;
+                if (exponent == 0x1F)
+                    bits = sign | 0x7F800000 | mantissa << 13;
+                else if (exponent)
+                    bits = sign | (exponent + 112) << 23 | mantissa << 13;
+                else if (!mantissa)
+                    bits = sign;
+                else
+                {
+                    int e = 1;
+                    while (!(mantissa & 0x400))
+                    {
+                        mantissa <<= 1;
+                        --e;
+                    }
+                    bits = sign | (uint32_t)(e + 112) << 23 | (mantissa & 0x3FF) << 13;
+                }
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                return f;
+#endif
+            }
+
+            inline void encode_half(float const x[], uint16_t h[], std::size_t n)
+            {
+                std::size_t i = 0;
+#ifdef __F16C__
+                for (; i + 8 <= n; i += 8)
+                    _mm_storeu_si128((__m128i *)(h + i), _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+                for (; i < n; ++i)
+                    h[i] = half_from_float(x[i]);
+            }
+
+            // x[i] = h[i], or x[i] += h[i] with accumulate.
+            inline void decode_half(uint16_t const h[], float x[], std::size_t n, bool accumulate)
+            {
+                std::size_t i = 0;
+#ifdef __F16C__
+                for (; i + 8 <= n; i += 8)
+                {
+                    __m256 v = _mm256_cvtph_ps(_mm_loadu_si128((__m128i const *)(h + i)));
+                    if (accumulate)
+                        v = _mm256_add_ps(v, _mm256_loadu_ps(x + i));
+                    _mm256_storeu_ps(x + i, v);
+                }
+#endif
+                for (; i < n; ++i)
+                    x[i] = accumulate ? x[i] + float_from_half(h[i]) : float_from_half(h[i]);
+            }
+
+            // One direction of a ring edge. Both calls move what they can without blocking:
+            // bytes moved, 0 if none could be, -1 once the link is broken.
+            class link
+            {
+            public:
+                virtual ~link() = default;
+                virtual ssize_t send_some(void const *data, std::size_t n) = 0;
+                virtual ssize_t recv_some(void *data, std::size_t n) = 0;
+
+                // Checked while a step makes no progress; false once the peer is known dead.
+                virtual bool alive() const { return true; }
+            };
+
+            class tcp_link final : public link
+            {
+                int fd;
+
+            public:
+                explicit tcp_link(int fd) : fd(fd)
+                {
+                    int one = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                }
+                ~tcp_link() override { close(fd); }
+
+                ssize_t send_some(void const *data, std::size_t n) override
+                {
+                    ssize_t const r = send(fd, data, n, MSG_NOSIGNAL);
+                    if (r < 0)
+                        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+                    return r;
+                }
+
+                ssize_t recv_some(void *data, std::size_t n) override
+                {
+                    ssize_t const r = recv(fd, data, n, 0);
+                    if (r < 0)
+                        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+                    return r ? r : -1;
+                }
+            };
+
+            // Byte ring in a shared mapping; head and tail count bytes ever written and read.
+            // Each end records its pid, so that the other can tell whether it still runs.
+            struct shm_ring
+            {
+                static constexpr std::size_t CAPACITY = 1 << 20;
+
+                alignas(64) std::atomic<uint64_t> head;
+                alignas(64) std::atomic<uint64_t> tail;
+                alignas(64) std::atomic<uint32_t> ready;
+                std::atomic<int32_t> receiver, sender; // pids; sender 0 until attached
+                alignas(64) unsigned char data[CAPACITY];
+            };
+
+            static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<int32_t>::is_always_lock_free,
+                          "shared-memory rings need address-free atomics");
+
+            inline std::string shm_path(std::string const &name, unsigned rank)
+            {
+                return "/dev/shm/" + name + "." + std::to_string(rank);
+            }
+
+            // The receiver creates its ring; the sender maps the one of the next rank. Only the
+            // receiver pops and only the sender pushes.
+            class shm_link final : public link
+            {
+                shm_ring *ring;
+                bool const receiving;
+
+                shm_link(shm_ring *ring, bool receiving) : ring(ring), receiving(receiving) {}
+
+            public:
+                ~shm_link() override { munmap(ring, sizeof(shm_ring)); }
+
+                static std::unique_ptr<shm_link> create(std::string const &path)
+                {
+                    unlink(path.c_str());
+                    int const fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+                    if (fd < 0)
+                        return nullptr;
+                    void *map = ftruncate(fd, sizeof(shm_ring)) == 0 ? mmap(nullptr, sizeof(shm_ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+                    close(fd);
+                    if (map == MAP_FAILED)
+                        return nullptr;
+                    shm_ring *ring = static_cast<shm_ring *>(map);
+                    ring->head.store(0, std::memory_order_relaxed);
+                    ring->tail.store(0, std::memory_order_relaxed);
+                    ring->receiver.store(getpid(), std::memory_order_relaxed);
+                    ring->sender.store(0, std::memory_order_relaxed);
+                    ring->ready.store(1, std::memory_order_release);
+                    return std::unique_ptr<shm_link>(new shm_link(ring, true));
+                }
+
+                // Null until the receiver has created and initialized its ring.
+                static std::unique_ptr<shm_link> attach(std::string const &path)
+                {
+                    int const fd = open(path.c_str(), O_RDWR);
+                    if (fd < 0)
+                        return nullptr;
+                    struct stat st;
+                    void *map = fstat(fd, &st) == 0 && (std::size_t)st.st_size == sizeof(shm_ring)
+                                    ? mmap(nullptr, sizeof(shm_ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                    : MAP_FAILED;
+                    close(fd);
+                    if (map == MAP_FAILED)
+                        return nullptr;
+                    shm_ring *ring = static_cast<shm_ring *>(map);
+                    if (ring->ready.load(std::memory_order_acquire) != 1)
+                    {
+                        munmap(map, sizeof(shm_ring));
+                        return nullptr;
+                    }
+                    ring->sender.store(getpid(), std::memory_order_relaxed);
+                    return std::unique_ptr<shm_link>(new shm_link(ring, false));
+                }
+
+                ssize_t send_some(void const *data, std::size_t n) override
+                {
+                    uint64_t const head = ring->head.load(std::memory_order_relaxed);
+                    std::size_t const space = shm_ring::CAPACITY - (std::size_t)(head - ring->tail.load(std::memory_order_acquire));
+                    n = std::min(n, space);
+                    std::size_t const at = head % shm_ring::CAPACITY, first = std::min(n, shm_ring::CAPACITY - at);
+                    memcpy(ring->data + at, data, first);
+                    memcpy(ring->data, (unsigned char const *)data + first, n - first);
+                    ring->head.store(head + n, std::memory_order_release);
+                    return (ssize_t)n;
+                }
+
+                ssize_t recv_some(void *data, std::size_t n) override
+                {
+                    uint64_t const tail = ring->tail.load(std::memory_order_relaxed);
+                    n = std::min(n, (std::size_t)(ring->head.load(std::memory_order_acquire) - tail));
+                    std::size_t const at = tail % shm_ring::CAPACITY, first = std::min(n, shm_ring::CAPACITY - at);
+                    memcpy(data, ring->data + at, first);
+                    memcpy((unsigned char *)data + first, ring->data, n - first);
+                    ring->tail.store(tail + n, std::memory_order_release);
+                    return (ssize_t)n;
+                }
+
+                bool alive() const override
+                {
+                    pid_t const peer = (receiving ? ring->sender : ring->receiver).load(std::memory_order_relaxed);
+                    return peer <= 0 || kill(peer, 0) == 0 || errno == EPERM;
+                }
+            };
+
+            inline int tcp_listen(uint16_t port, bool loopback)
+            {
+                int fd = socket(AF_INET, SOCK_STREAM, 0);
+                if (fd < 0)
+                    return -1;
+                int one = 1;
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                sockaddr_in addr = {};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(port);
+                addr.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+                if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0)
+                {
+                    close(fd);
+                    return -1;
+                }
+                return fd;
+            }
+
+            inline int tcp_connect(std::string const &host, uint16_t port)
+            {
+                sockaddr_in addr = {};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(port);
+                if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+                    return -1;
+                int fd = socket(AF_INET, SOCK_STREAM, 0);
+                if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+                {
+                    close(fd);
+                    return -1;
+                }
+                return fd;
+            }
+
+            inline bool wait_readable(int fd, std::chrono::steady_clock::time_point deadline)
+            {
+                auto const left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                pollfd p = {fd, POLLIN, 0};
+                return left > 0 && poll(&p, 1, (int)left) == 1;
+            }
+        };
+
+        class RingAllReduce
+        {
+            ring_config const config;
+            std::unique_ptr<detail::link> next, prev;
+            std::vector<uint16_t> send_half, recv_half;
+            std::vector<float> recv_full;
+            uint64_t moved = 0;
+
+            explicit RingAllReduce(ring_config const &config) : config(config) {}
+
+            std::string const &host(unsigned r) const
+            {
+                static std::string const loopback = "127.0.0.1";
+                return config.hosts.empty() ? loopback : config.hosts[r];
+            }
+
+            bool shared_memory_to(unsigned r) const
+            {
+                return config.kind == transport::shm || (config.kind == transport::automatic && host(r) == host(config.rank));
+            }
+
+            // Sends and receives at once until both buffers are through. False if a link
+            // broke, a peer died, or nothing moved for config.timeout.
+            bool exchange(void const *out, std::size_t n_out, void *in, std::size_t n_in)
+            {
+                std::size_t sent = 0, received = 0;
+                unsigned spins = 0;
+                std::chrono::steady_clock::time_point stalled;
+                while (sent < n_out || received < n_in)
+                {
+                    ssize_t const s = sent < n_out ? next->send_some((char const *)out + sent, n_out - sent) : 0;
+                    ssize_t const r = received < n_in ? prev->recv_some((char *)in + received, n_in - received) : 0;
+                    if (s < 0 || r < 0)
+                        return false;
+                    sent += s;
+                    received += r;
+                    if (s || r)
+                    {
+                        spins = 0;
+                        continue;
+                    }
+                    if (spins == 0)
+                        stalled = std::chrono::steady_clock::now();
+                    streaming::detail::backoff(spins);
+                    if (spins % 256 == 0) // every 256 idle rounds, about 13 ms once sleeping
+                    {
+                        if (!next->alive() || !prev->alive() || std::chrono::steady_clock::now() - stalled > config.timeout)
+                            return false;
+                    }
+                }
+                moved += n_out;
+                return true;
+            }
+
+            // Sends chunk `out` of data and receives chunk `in` into it, added or copied.
+            bool step(float data[], std::size_t n, unsigned out, unsigned in, bool accumulate, bool compress)
+            {
+                unsigned const N = config.world;
+                std::size_t const out_begin = out * n / N, out_len = (out + 1) * n / N - out_begin;
+                std::size_t const in_begin = in * n / N, in_len = (in + 1) * n / N - in_begin;
+                float *target = data + in_begin;
+
+                if (compress)
+                {
+                    detail::encode_half(data + out_begin, send_half.data(), out_len);
+                    if (!exchange(send_half.data(), out_len * sizeof(uint16_t), recv_half.data(), in_len * sizeof(uint16_t)))
+                        return false;
+                    detail::decode_half(recv_half.data(), target, in_len, accumulate);
+                    return true;
+                }
+                if (!exchange(data + out_begin, out_len * sizeof(float), recv_full.data(), in_len * sizeof(float)))
+                    return false;
+                for (std::size_t i = 0; i < in_len; ++i)
+                    target[i] = accumulate ? target[i] + recv_full[i] : recv_full[i];
+                return true;
+            }
+
+        public:
+            // Forms the ring: every rank must call it with the same config but its own rank.
+            // Null if the ring does not form within config.timeout.
+            static std::unique_ptr<RingAllReduce> connect(ring_config const &config)
+            {
+                if (config.world == 0 || config.rank >= config.world || (!config.hosts.empty() && config.hosts.size() != config.world))
+                    return nullptr;
+                std::unique_ptr<RingAllReduce> ring(new RingAllReduce(config));
+                if (config.world == 1)
+                    return ring;
+
+                unsigned const r = config.rank, N = config.world;
+                unsigned const next_rank = (r + 1) % N, prev_rank = (r + N - 1) % N;
+                auto const deadline = std::chrono::steady_clock::now() + config.timeout;
+                bool const shm_out = ring->shared_memory_to(next_rank), shm_in = ring->shared_memory_to(prev_rank);
+                bool loopback = true;
+                for (unsigned i = 0; i < N; ++i)
+                    loopback &= ring->host(i) == "127.0.0.1";
+
+                // Inbound side first, so the previous rank finds it while we look for the next.
+                int listener = -1;
+                if (shm_in)
+                {
+                    ring->prev = detail::shm_link::create(detail::shm_path(config.shm_name, r));
+                    if (!ring->prev)
+                        return nullptr;
+                }
+                else if ((listener = detail::tcp_listen(config.port + r, loopback)) < 0)
+                {
+                    return nullptr;
+                }
+
+                while (!ring->next)
+                {
+                    if (shm_out)
+                    {
+                        ring->next = detail::shm_link::attach(detail::shm_path(config.shm_name, next_rank));
+                    }
+                    else
+                    {
+                        int const fd = detail::tcp_connect(ring->host(next_rank), config.port + next_rank);
+                        uint32_t const me = r;
+                        if (fd >= 0 && serving::write_full(fd, &me, sizeof(me)))
+                            ring->next.reset(new detail::tcp_link(fd));
+                        else if (fd >= 0)
+                            close(fd);
+                    }
+                    if (!ring->next)
+                    {
+                        if (std::chrono::steady_clock::now() > deadline)
+                            break;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    }
+                }
+
+                if (listener >= 0)
+                {
+                    while (ring->next && !ring->prev && detail::wait_readable(listener, deadline))
+                    {
+                        // A rank sends its number as soon as it connects; a client that sends
+                        // nothing is dropped after a second, so it cannot hold up the ring.
+                        int const fd = accept(listener, nullptr, nullptr);
+                        auto const hello = std::min(deadline, std::chrono::steady_clock::now() + std::chrono::seconds(1));
+                        uint32_t peer = 0;
+                        if (fd >= 0 && detail::wait_readable(fd, hello) && serving::read_full(fd, &peer, sizeof(peer)) && peer == prev_rank)
+                            ring->prev.reset(new detail::tcp_link(fd));
+                        else if (fd >= 0)
+                            close(fd);
+                    }
+                    close(listener);
+                }
+
+                // Once every rank is through this barrier, every sender has mapped its ring.
+                float token = 1;
+                bool const formed = ring->next && ring->prev && ring->sum(&token, 1, false) && token == N;
+                if (shm_in)
+                    unlink(detail::shm_path(config.shm_name, r).c_str());
+                return formed ? std::move(ring) : nullptr;
+            }
+
+            unsigned rank() const { return config.rank; }
+            unsigned world() const { return config.world; }
+            bool compressed() const { return config.fp16; }
+
+            // Payload bytes this rank has sent so far.
+            uint64_t bytes_sent() const { return moved; }
+
+            // data = its sum over all ranks, in half precision on the wire with config.fp16.
+            // False if a link broke, a peer died or a step stalled for config.timeout; the ring is
+            // then unusable.
+            bool sum(float data[], std::size_t n) { return sum(data, n, config.fp16); }
+
+            // The same with half precision on the wire or not, whatever config.fp16 says.
+            bool sum(float data[], std::size_t n, bool compress)
+            {
+                unsigned const N = config.world, r = config.rank;
+                if (N == 1)
+                    return true;
+                std::size_t const chunk = n / N + 1;
+                if (compress)
+                {
+                    send_half.resize(chunk);
+                    recv_half.resize(chunk);
+                }
+                else
+                {
+                    recv_full.resize(chunk);
+                }
+
+                for (unsigned s = 0; s + 1 < N; ++s)
+                    if (!step(data, n, (r + N - s) % N, (r + 2 * N - s - 1) % N, true, compress))
+                        return false;
+
+                if (compress)
+                {
+                    unsigned const own = (r + 1) % N;
+                    float *total = data + own * n / N;
+                    std::size_t const len = (own + 1) * n / N - own * n / N;
+                    for (std::size_t i = 0; i < len; ++i)
+                        total[i] = detail::float_from_half(detail::half_from_float(total[i]));
+                }
+
+                for (unsigned s = 0; s + 1 < N; ++s)
+                    if (!step(data, n, (r + 1 + N - s) % N, (r + N - s) % N, false, compress))
+                        return false;
+                return true;
+            }
+
+            // data = root's data, exactly, on every rank.
+            bool broadcast(float data[], std::size_t n, unsigned root = 0)
+            {
+                if (config.rank != root)
+                    std::fill(data, data + n, 0.0f);
+                return sum(data, n, false);
+            }
+        };
+
+        template <typename Model>
+        class DataParallelTrainer
+        {
+        public:
+            using float_t = typename Model::value_type;
+            static_assert(std::is_same<float_t, float>::value, "the ring reduces single-precision buffers");
+            static constexpr std::size_t DEPTH = Model::depth();
+
+        private:
+            template <std::size_t L>
+            using layer_t = typename Model::template layer_type<L>;
+            using input_t = activations_t<float_t, Model::inputs(), 1>;
+
+            template <std::size_t... L>
+            static auto make_activations(std::index_sequence<L...>) -> std::tuple<std::vector<input_t>, std::vector<typename layer_t<L>::outputs_t>...>;
+            template <std::size_t... L>
+            static auto make_gradients(std::index_sequence<L...>) -> std::tuple<std::unique_ptr<typename layer_t<L>::gradient_t>...>;
+
+            Model &model;
+            RingAllReduce &ring;
+            std::size_t const batch;
+
+            decltype(make_activations(std::make_index_sequence<DEPTH>{})) acts, errs; // errs[0] unused
+            decltype(make_gradients(std::make_index_sequence<DEPTH>{})) grads;
+            std::vector<float_t> flat;
+            double reduce_ns = 0;
+
+            template <std::size_t... L>
+            void allocate(std::index_sequence<L...>)
+            {
+                std::get<0>(acts).resize(batch);
+                ((std::get<L + 1>(acts).resize(batch), std::get<L + 1>(errs).resize(batch)), ...);
+                ((std::get<L>(grads).reset(new typename layer_t<L>::gradient_t())), ...);
+            }
+
+            // Gradient rows of every layer to or from the flat buffer, bias column included.
+            template <bool TO_FLAT, std::size_t... L>
+            void pack(std::index_sequence<L...>)
+            {
+                std::size_t at = 0;
+                auto one = [&](auto &grad, std::size_t outputs, std::size_t width)
+                {
+                    for (std::size_t i = 0; i < outputs; ++i, at += width)
+                    {
+                        float_t *row = grad.begin()[i].begin();
+                        if (TO_FLAT)
+                            std::copy(row, row + width, flat.data() + at);
+                        else
+                            std::copy(flat.data() + at, flat.data() + at + width, row);
+                    }
+                };
+                ((one(*std::get<L>(grads), layer_t<L>::size(), layer_t<L>::inputs() + 1)), ...);
+            }
+
+            template <std::size_t... L>
+            void weights(bool to_flat, std::index_sequence<L...>)
+            {
+                std::size_t at = 0;
+                auto one = [&](auto &layer)
+                {
+                    std::size_t const width = layer.inputs() + 1;
+                    for (std::size_t i = 0; i < layer.size(); ++i, at += width)
+                    {
+                        float_t *row = layer.get_weights().begin()[i].begin();
+                        if (to_flat)
+                            std::copy(row, row + width, flat.data() + at);
+                        else
+                            std::copy(flat.data() + at, flat.data() + at + width, row);
+                    }
+                };
+                ((one(model.template layer<L>())), ...);
+            }
+
+            template <std::size_t... L>
+            void forward(std::size_t n, std::index_sequence<L...>)
+            {
+                ((model.template layer<L>().feed_batch(std::get<L>(acts).data(), std::get<L + 1>(acts).data(), n)), ...);
+            }
+
+            template <std::size_t... L>
+            void backward(std::size_t n, std::index_sequence<L...>)
+            {
+                ((model.template layer<L>().backward_batch(std::get<L>(acts).data(), std::get<L + 1>(acts).data(), std::get<L + 1>(errs).data(),
+                                                           *std::get<L>(grads), L == 0 ? nullptr : std::get<L>(errs).data(), n)),
+                 ...);
+            }
+
+            template <std::size_t... L>
+            void apply(float_t rate, std::index_sequence<L...>)
+            {
+                ((model.template layer<L>().apply_gradient(*std::get<L>(grads), rate)), ...);
+            }
+
+        public:
+            // batch samples per rank and step; the global mini-batch is world() * batch.
+            DataParallelTrainer(Model &model, RingAllReduce &ring, std::size_t batch = 16)
+                : model(model), ring(ring), batch(batch ? batch : 1), flat(parameters())
+            {
+                allocate(std::make_index_sequence<DEPTH>{});
+            }
+
+            // Weights of the model, bias included: the floats reduced per step.
+            static constexpr std::size_t parameters()
+            {
+                auto const widths = Model::topology();
+                std::size_t n = 0;
+                for (std::size_t l = 0; l < DEPTH; ++l)
+                    n += (widths[l] + 1) * widths[l + 1];
+                return n;
+            }
+
+            // Copies rank 0's weights to every replica; call once before training.
+            bool sync_weights()
+            {
+                weights(true, std::make_index_sequence<DEPTH>{});
+                if (!ring.broadcast(flat.data(), flat.size()))
+                    return false;
+                weights(false, std::make_index_sequence<DEPTH>{});
+                return true;
+            }
+
+            // Largest weight difference between this replica and rank 0's, the same on all ranks.
+            bool divergence(float_t &max_diff)
+            {
+                weights(true, std::make_index_sequence<DEPTH>{});
+                std::vector<float_t> mine = flat;
+                if (!ring.broadcast(flat.data(), flat.size()))
+                    return false;
+                std::vector<float_t> diffs(ring.world(), 0);
+                for (std::size_t i = 0; i < flat.size(); ++i)
+                    diffs[ring.rank()] = std::max(diffs[ring.rank()], (float_t)fabs(mine[i] - flat[i]));
+                if (!ring.sum(diffs.data(), diffs.size(), false)) // exact, even on an fp16 ring
+                    return false;
+                max_diff = *std::max_element(diffs.begin(), diffs.end());
+                return true;
+            }
+
+            // Trains on this rank's n row-major samples, one step per batch. Every rank must
+            // pass the same n, or the ranks run out of step. The ranks' gradients are averaged
+            // before the step at rate. False if the ring broke.
+            bool train(float_t const input[], float_t const answer[], std::size_t n, float_t rate)
+            {
+                for (std::size_t begin = 0; begin < n; begin += batch)
+                {
+                    std::size_t const count = std::min(batch, n - begin);
+                    for (std::size_t b = 0; b < count; ++b)
+                    {
+                        auto &x = std::get<0>(acts)[b];
+                        for (std::size_t i = 0; i < Model::inputs(); ++i)
+                            x[i] = input[(begin + b) * Model::inputs() + i];
+                        x[Model::inputs()] = 1;
+                    }
+                    forward(count, std::make_index_sequence<DEPTH>{});
+                    for (std::size_t b = 0; b < count; ++b)
+                    {
+                        auto const &out = std::get<DEPTH>(acts)[b];
+                        auto &err = std::get<DEPTH>(errs)[b];
+                        for (std::size_t o = 0; o < Model::outputs(); ++o)
+                            err[o] = answer[(begin + b) * Model::outputs() + o] - out[o];
+                    }
+                    backward(count, makeIndexSequenceReverse<DEPTH>{});
+
+                    auto const t0 = std::chrono::steady_clock::now();
+                    pack<true>(std::make_index_sequence<DEPTH>{});
+                    if (!ring.sum(flat.data(), flat.size()))
+                        return false;
+                    pack<false>(std::make_index_sequence<DEPTH>{});
+                    reduce_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+
+                    apply(rate / ring.world(), std::make_index_sequence<DEPTH>{}); // the mean over ranks
+                }
+                return true;
+            }
+
+            // Time spent packing and reducing gradients so far.
+            double reduce_ms() const { return reduce_ns / 1e6; }
+        };
+    };
+};
+
+#endif
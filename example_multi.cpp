@@ -0,0 +1,61 @@
+#include "multi_mlp.hpp"
+#include "iris.hpp"
+
+// Learning-rate sweep: every lane of MultiMLP is an independent model with its own
+// learning rate and seed, all trained in the same pass over the data.
+
+#define epochs 100000
+#define rand_seed 0
+#define n_models (pure_simd::native_vectorsize<float>())
+
+namespace mai = meta_ai;
+
+using Sweep = mai::MultiMLP<float, n_models, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>>;
+
+Sweep sweep(pure_simd::iota<Sweep::seed_t, unsigned int>(5u, 7919u));
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+int main(int argc, char **argv)
+{
+    srand(rand_seed);
+    readIris(feat, label);
+
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    auto const rates = pure_simd::iota<Sweep::lane_t>(0.025f, 0.025f);
+
+    printf("Training %d models at once\n", (int)Sweep::models());
+    CHECK_TIME(
+        for (int i = 0; i < epochs; i++) {
+            shuffle(order, train_rows);
+            for (int j = 0; j < train_rows; j++)
+            {
+                int row = order[j];
+                sweep.train(feat + row * cols, label + row * out_cols, rates);
+            }
+        })
+
+    int correct[n_models] = {};
+
+    for (int i = train_rows; i < rows; ++i)
+    {
+        int row = order[i];
+        auto const &prediction = sweep.predict(feat + row * cols);
+
+        for (int m = 0; m < n_models; ++m)
+        {
+            float p[out_cols] = {prediction[0][m], prediction[1][m], prediction[2][m]};
+            correct[m] += matches(p, label + row * out_cols);
+        }
+    }
+
+    for (int m = 0; m < n_models; ++m)
+        printf("model %2d  rate %.3f  correct %d/%d\n", m, rates[m], correct[m], rows - train_rows);
+
+    return EXIT_SUCCESS;
+}
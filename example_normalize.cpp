@@ -0,0 +1,98 @@
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+#include "normalize.hpp"
+#include "iris.hpp"
+
+// Standardizes the Iris features with statistics from the training split, trains on the
+// standardized inputs, then folds the standardization into the first layer and checks
+// that the exported model gives the same predictions on raw measurements.
+
+#define epochs 2000
+#define learning_rate 0.1
+#define rand_seed 0
+#define export_path "iris_folded.ckpt"
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>>;
+
+Model mlp;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+float train_feat[train_rows * cols];
+
+int main(int argc, char **argv)
+{
+    srand(rand_seed);
+    readIris(feat, label);
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    // One pass over the training rows only, so the test rows do not leak into the scaling.
+    for (int j = 0; j < train_rows; ++j)
+        memcpy(train_feat + j * cols, feat + order[j] * cols, cols * sizeof(float));
+    mai::FeatureStats<float, cols> stats;
+    stats.add_rows(train_feat, train_rows);
+    mai::Normalizer<float, cols> const norm(stats, mai::normalization::standard);
+    for (int k = 0; k < cols; ++k)
+        printf("feature %d: mean %.3f std %.3f range [%.1f, %.1f]\n", k, stats.mean(k), stats.stddev(k), stats.min(k), stats.max(k));
+
+    float scaled[rows * cols];
+    norm.apply_rows(feat, scaled, rows);
+
+    CHECK_TIME(
+        for (int i = 0; i < epochs; i++) {
+            shuffle(order, train_rows);
+            for (int j = 0; j < train_rows; j++)
+            {
+                int row = order[j];
+                mlp.train(scaled + row * cols, label + row * out_cols, learning_rate);
+            }
+        })
+
+    Model folded = mlp;
+    mai::fold_normalization(folded, norm);
+
+    int correct = 0, folded_correct = 0;
+    float max_diff = 0;
+    for (int i = train_rows; i < rows; ++i)
+    {
+        int const row = order[i];
+        float p[out_cols], q[out_cols];
+        auto const &a = mlp.predict(scaled + row * cols);
+        std::copy(a.begin(), a.begin() + out_cols, p);
+        auto const &b = folded.predict(feat + row * cols);
+        std::copy(b.begin(), b.begin() + out_cols, q);
+        correct += matches(p, label + row * out_cols);
+        folded_correct += matches(q, label + row * out_cols);
+        for (int k = 0; k < out_cols; ++k)
+            max_diff = std::max(max_diff, fabsf(p[k] - q[k]));
+    }
+    printf("normalized inputs: %d/%d correct; folded model on raw inputs: %d/%d correct, max output difference %g\n",
+           correct, rows - train_rows, folded_correct, rows - train_rows, max_diff);
+
+    // Per-request cost: normalize-then-predict against the folded model alone.
+    int const reps = 200000;
+    float tmp[cols];
+    float sink = 0;
+    double const with_norm = funcTime([&]
+                                      {
+                                          for (int r = 0; r < reps; ++r)
+                                          {
+                                              norm.apply(feat + (r % rows) * cols, tmp);
+                                              sink += mlp.predict(tmp)[0];
+                                          } });
+    double const without = funcTime([&]
+                                    {
+                                        for (int r = 0; r < reps; ++r)
+                                            sink += folded.predict(feat + (r % rows) * cols)[0];
+                                    });
+    printf("predict with normalization %.1f ns, folded %.1f ns (checksum %g)\n", with_norm / reps, without / reps, sink);
+
+    if (mai::save_checkpoint(folded, export_path))
+        printf("exported %s (takes raw measurements)\n", export_path);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+#include "codegen.hpp"
+#include "iris.hpp"
+
+// Trains the Iris model and exports it twice: as a checkpoint for the runtime MLP and as
+// a generated header (codegen.hpp) with the weights compiled in. bench_codegen compares
+// the two; build it after running this.
+//
+//   ./export_iris [header] [checkpoint]     defaults: iris_model.hpp iris_model.ckpt
+
+#define epochs 20000
+#define learning_rate 0.1
+#define rand_seed 0
+
+namespace mai = meta_ai;
+
+mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>> mlp;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+int main(int argc, char **argv)
+{
+    char const *header = argc > 1 ? argv[1] : "iris_model.hpp";
+    char const *checkpoint = argc > 2 ? argv[2] : "iris_model.ckpt";
+
+    srand(rand_seed);
+    readIris(feat, label);
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    CHECK_TIME(
+        for (int i = 0; i < epochs; i++) {
+            shuffle(order, train_rows);
+            for (int j = 0; j < train_rows; j++)
+            {
+                int row = order[j];
+                mlp.train(feat + row * cols, label + row * out_cols, learning_rate);
+            }
+        })
+
+    int correct = 0;
+    for (int i = train_rows; i < rows; ++i)
+    {
+        int const row = order[i];
+        float p[out_cols];
+        auto const &prediction = mlp.predict(feat + row * cols);
+        std::copy(prediction.begin(), prediction.begin() + out_cols, p);
+        correct += matches(p, label + row * out_cols);
+    }
+    printf("%d/%d test rows correct\n", correct, rows - train_rows);
+
+    if (!mai::save_checkpoint(mlp, checkpoint) || !mai::export_header(mlp, header, "iris_model"))
+    {
+        fprintf(stderr, "export failed\n");
+        return EXIT_FAILURE;
+    }
+    printf("wrote %s and %s\n", checkpoint, header);
+    return EXIT_SUCCESS;
+}
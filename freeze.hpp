@@ -0,0 +1,165 @@
+#ifndef __FREEZE_H__
+#define __FREEZE_H__
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "mlp.hpp"
+
+// Fine-tuning with a frozen prefix of layers.
+//
+// FrozenPrefixTrainer<Model, FROZEN> keeps perceptron layers [0, FROZEN) of a model
+// fixed. cache() runs every training sample once through them and stores the outputs of
+// the last frozen layer, WIDTH floats per sample without bias lane or padding, on the
+// heap or in a file mapped with mmap for sets larger than memory. train() then loads a
+// sample's cached activations into the boundary layer (Layer::load), feeds only the
+// trainable suffix and tunes it from the output layer down to layer FROZEN; backprop
+// stops there, since no frozen layer is tuned. Each step makes the same update to the
+// suffix as MLP::train would, with the prefix left as it was.
+
+namespace meta_ai
+{
+    template <typename Model, std::size_t FROZEN>
+    class FrozenPrefixTrainer
+    {
+    public:
+        using float_t = typename Model::value_type;
+        static constexpr std::size_t DEPTH = Model::depth();
+        static_assert(FROZEN >= 1 && FROZEN < DEPTH, "freeze at least one layer and leave at least one to train");
+
+        // Cached floats per sample: the width of the last frozen layer.
+        static constexpr std::size_t WIDTH = Model::topology()[FROZEN];
+
+    private:
+        Model &model;
+        Layer<float_t, INPUT<Model::inputs()>> input_layer;
+        Layer<float_t, OUTPUT<Model::outputs()>> answer_layer;
+
+        std::vector<float_t> memory;
+        float_t *activations = nullptr;
+        void *map = MAP_FAILED;
+        std::size_t n = 0;
+
+        template <std::size_t L>
+        auto const &prev_of() const
+        {
+            if constexpr (L == 0)
+                return input_layer;
+            else
+                return model.template layer<L - 1>();
+        }
+
+        template <std::size_t L>
+        auto const &next_of() const
+        {
+            if constexpr (L + 1 == DEPTH)
+                return answer_layer;
+            else
+                return model.template layer<L + 1>();
+        }
+
+        template <std::size_t... L>
+        void feed(std::index_sequence<L...>)
+        {
+            ((model.template layer<L>().feed(prev_of<L>())), ...);
+        }
+
+        // Layers FROZEN + I, from the output layer down.
+        template <std::size_t... I>
+        void tune(float_t rate, std::index_sequence<I...>)
+        {
+            ((model.template layer<DEPTH - 1 - I>().tune(prev_of<DEPTH - 1 - I>(), next_of<DEPTH - 1 - I>(), rate)), ...);
+        }
+
+        template <std::size_t... I>
+        void feed_suffix(std::index_sequence<I...>)
+        {
+            ((model.template layer<FROZEN + I>().feed(prev_of<FROZEN + I>())), ...);
+        }
+
+        void release()
+        {
+            if (map != MAP_FAILED)
+                munmap(map, n * WIDTH * sizeof(float_t));
+            map = MAP_FAILED;
+            memory.clear();
+            memory.shrink_to_fit();
+            activations = nullptr;
+            n = 0;
+        }
+
+    public:
+        explicit FrozenPrefixTrainer(Model &model) : model(model) {}
+        ~FrozenPrefixTrainer() { release(); }
+
+        FrozenPrefixTrainer(FrozenPrefixTrainer const &) = delete;
+        FrozenPrefixTrainer &operator=(FrozenPrefixTrainer const &) = delete;
+
+        // Runs n row-major samples through the frozen layers and keeps their outputs, in
+        // memory or, given a path, in that file (created or truncated). Replaces any earlier
+        // cache. False if the file cannot be created or mapped.
+        bool cache(float_t const input[], std::size_t n, char const *path = nullptr)
+        {
+            release();
+            std::size_t const bytes = n * WIDTH * sizeof(float_t);
+            if (path)
+            {
+                int const fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+                if (fd < 0)
+                    return false;
+                if (bytes && ftruncate(fd, bytes) == 0)
+                    map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                if (bytes && map == MAP_FAILED)
+                    return false;
+                activations = bytes ? static_cast<float_t *>(map) : nullptr;
+            }
+            else
+            {
+                memory.resize(n * WIDTH);
+                activations = memory.data();
+            }
+            this->n = n;
+
+            auto const &boundary = model.template layer<FROZEN - 1>();
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                input_layer.load(input + i * Model::inputs());
+                feed(std::make_index_sequence<FROZEN>{});
+                float_t const *out = boundary.get_outputs().begin();
+                std::copy(out, out + WIDTH, activations + i * WIDTH);
+            }
+            return true;
+        }
+
+        std::size_t size() const { return n; }
+        std::size_t bytes() const { return n * WIDTH * sizeof(float_t); }
+        float_t const *cached(std::size_t i) const { return activations + i * WIDTH; }
+
+        // One step on cached sample i. Returns its squared error before the update, as
+        // MLP::train does.
+        float_t train(std::size_t i, float_t const answer[], float_t rate)
+        {
+            model.template layer<FROZEN - 1>().load(cached(i));
+            feed_suffix(std::make_index_sequence<DEPTH - FROZEN>{});
+
+            auto const &prediction = model.template layer<DEPTH - 1>().get_outputs();
+            float_t loss = 0;
+            for (std::size_t k = 0; k < Model::outputs(); ++k)
+            {
+                float_t const error = answer[k] - prediction[k];
+                loss += error * error;
+            }
+
+            answer_layer.load(answer);
+            tune(rate, std::make_index_sequence<DEPTH - FROZEN>{});
+            return loss;
+        }
+    };
+};
+
+#endif
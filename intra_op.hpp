@@ -0,0 +1,208 @@
+#ifndef __INTRA_OP_H__
+#define __INTRA_OP_H__
+
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <immintrin.h>
+#include "mlp.hpp"
+#include "numerics.hpp"
+
+// Intra-layer parallelism for single requests on wide models.
+//
+// IntraOpPool keeps threads - 1 workers parked next to the caller. run() publishes a job
+// by bumping a generation counter; the workers, which spin on it for a while after each
+// job and then sleep on it with a futex, claim chunks from a shared counter, and so does
+// the calling thread. The caller returns when every chunk has finished, which is the
+// barrier between one layer and the next. Back-to-back layers find the workers still
+// spinning, so a barrier costs well under a microsecond instead of a wake-up.
+//
+// enable_intra_op(model, &pool) hands the pool to every WideLayer of a model; those
+// split feed and tune by neuron when they have at least INTRA_OP_MIN_MACS weights.
+// Unrolled layers and feed_batch stay single-threaded.
+
+namespace meta_ai
+{
+    class IntraOpPool final : public parallel_executor
+    {
+        std::vector<std::thread> workers;
+        unsigned const spin_limit;
+
+        // Taken by run(); a second concurrent caller runs its job inline instead of waiting.
+        std::mutex busy;
+
+        alignas(64) std::atomic<uint32_t> generation{0};
+        std::atomic<uint32_t> sleepers{0};
+        std::atomic<bool> stopping{false};
+
+        // Current job, published by the release store of claim and only read while holding
+        // one of its chunks, so the next run() cannot overwrite it underneath.
+        body_t body = nullptr;
+        void *arg = nullptr;
+        std::size_t n = 0, grain = 1;
+
+        // generation (32 bits) | chunks (16) | next chunk to claim (16). One word, so a
+        // worker still around from an earlier job can never claim a chunk of the next one.
+        alignas(64) std::atomic<uint64_t> claim{0};
+        alignas(64) std::atomic<std::size_t> finished{0};
+
+        static void pause() { _mm_pause(); }
+
+        static void futex_wait(std::atomic<uint32_t> &word, uint32_t expected)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+        }
+
+        static void futex_wake_all(std::atomic<uint32_t> &word)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+        }
+
+        // Claims and runs chunks of job seq until none is left.
+        void work_chunks(uint32_t seq)
+        {
+            uint64_t state = claim.load(std::memory_order_acquire);
+            for (;;)
+            {
+                std::size_t const total = (state >> 16) & 0xFFFF, c = state & 0xFFFF;
+                if ((uint32_t)(state >> 32) != seq || c >= total)
+                    return;
+                if (!claim.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                    continue;
+
+                std::size_t const units = (n + grain - 1) / grain;
+                std::size_t const begin = c * units / total * grain;
+                std::size_t const end = std::min(n, (c + 1) * units / total * grain);
+                body(arg, begin, end);
+                finished.fetch_add(1, std::memory_order_release);
+                state = claim.load(std::memory_order_acquire);
+            }
+        }
+
+        void work()
+        {
+            uint32_t seen = generation.load(std::memory_order_acquire);
+            for (;;)
+            {
+                unsigned spins = 0;
+                while (generation.load(std::memory_order_acquire) == seen && !stopping.load(std::memory_order_relaxed))
+                {
+                    if (++spins < spin_limit)
+                    {
+                        pause();
+                        continue;
+                    }
+                    sleepers.fetch_add(1);
+                    futex_wait(generation, seen);
+                    sleepers.fetch_sub(1);
+                    spins = 0;
+                }
+                if (stopping.load(std::memory_order_relaxed))
+                    return;
+                seen = generation.load(std::memory_order_acquire);
+                detail::follow_denormal_mode();
+                work_chunks(seen);
+            }
+        }
+
+    public:
+        // threads counts the caller: IntraOpPool(4) starts 3 workers. spin_limit is how many
+        // pause iterations (about 10-40 ns each) a worker polls before sleeping.
+        explicit IntraOpPool(std::size_t threads = std::thread::hardware_concurrency(), unsigned spin_limit = 1 << 14)
+            : spin_limit(spin_limit)
+        {
+            for (std::size_t i = 1; i < threads; ++i)
+                workers.emplace_back([this]
+                                     { work(); });
+        }
+
+        ~IntraOpPool()
+        {
+            stopping = true;
+            generation.fetch_add(1);
+            futex_wake_all(generation);
+            for (auto &worker : workers)
+                worker.join();
+        }
+
+        IntraOpPool(IntraOpPool const &) = delete;
+        IntraOpPool &operator=(IntraOpPool const &) = delete;
+
+        std::size_t size() const { return workers.size() + 1; }
+
+        void run(std::size_t n, std::size_t grain, body_t body, void *arg) override
+        {
+            grain = grain ? grain : 1;
+            std::size_t const total = std::min({size(), (n + grain - 1) / grain, std::size_t{0xFFFF}});
+            if (total <= 1 || !busy.try_lock())
+            {
+                body(arg, 0, n);
+                return;
+            }
+            std::lock_guard<std::mutex> guard(busy, std::adopt_lock);
+
+            this->body = body;
+            this->arg = arg;
+            this->n = n;
+            this->grain = grain;
+            finished.store(0, std::memory_order_relaxed);
+            uint32_t const seq = generation.load(std::memory_order_relaxed) + 1;
+            claim.store((uint64_t)seq << 32 | (uint64_t)total << 16, std::memory_order_release);
+
+            generation.store(seq);
+            if (sleepers.load())
+                futex_wake_all(generation);
+
+            work_chunks(seq);
+            unsigned spins = 0;
+            while (finished.load(std::memory_order_acquire) < total)
+            {
+                if (++spins < spin_limit)
+                    pause();
+                else
+                    std::this_thread::yield();
+            }
+        }
+    };
+
+    namespace detail
+    {
+        template <typename L, typename = void>
+        struct has_executor : std::false_type
+        {
+        };
+
+        template <typename L>
+        struct has_executor<L, std::void_t<decltype(std::declval<L &>().set_executor(nullptr))>> : std::true_type
+        {
+        };
+    };
+
+    // Gives executor (nullptr: none) to every layer that can split its passes. Returns how
+    // many layers will actually be split, i.e. wide ones over INTRA_OP_MIN_MACS.
+    template <typename Model>
+    std::size_t enable_intra_op(Model &model, parallel_executor *executor)
+    {
+        std::size_t split = 0;
+        model.for_each_layer([&](auto &layer)
+                             {
+                                 using layer_t = std::decay_t<decltype(layer)>;
+                                 if constexpr (detail::has_executor<layer_t>::value)
+                                 {
+                                     layer.set_executor(executor);
+                                     split += executor && layer_t::size() * (layer_t::inputs() + 1) >= INTRA_OP_MIN_MACS;
+                                 } });
+        return split;
+    }
+};
+
+#endif
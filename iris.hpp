@@ -0,0 +1,114 @@
+#ifndef __IRIS_H__
+#define __IRIS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <utility>
+#include <time.h>
+#include <math.h>
+
+// Shared helpers for the example programs: Iris loading, shuffling and timing.
+
+#define CHECK_TIME(x)                                                                                       \
+    {                                                                                                       \
+        struct timespec start, end;                                                                         \
+        clock_gettime(CLOCK_REALTIME, &start);                                                              \
+        x;                                                                                                  \
+        clock_gettime(CLOCK_REALTIME, &end);                                                                \
+        double f = ((double)end.tv_sec * 1e9 + end.tv_nsec) - ((double)start.tv_sec * 1e9 + start.tv_nsec); \
+        printf("time %f ms\n", f / 1000000);                                                                \
+    }
+
+typedef std::chrono::high_resolution_clock::time_point TimeVar;
+
+#define duration(a) std::chrono::duration_cast<std::chrono::nanoseconds>(a).count()
+#define timeNow() std::chrono::high_resolution_clock::now()
+
+template <typename F, typename... Args>
+double funcTime(F func, Args &&...args)
+{
+    TimeVar t1 = timeNow();
+    func(std::forward<Args>(args)...);
+    return duration(timeNow() - t1);
+}
+
+#define cols 4
+#define out_cols 3
+#define rows 150
+#define train_rows 105
+
+inline void readIris(float feat[], float label[])
+{
+
+    char const *const dataFileName = "iris.data";
+
+    memset(feat, 0, rows * cols * sizeof(float));
+    memset(label, 0, rows * out_cols * sizeof(float));
+
+    printf("Obsns size is %d and feat size is %d.\n", rows, cols);
+
+    FILE *fpDataFile = fopen(dataFileName, "r");
+
+    if (!fpDataFile)
+    {
+        printf("Missing input file: %s\n", dataFileName);
+        exit(1);
+    }
+
+    int index = 0;
+    char line[1024];
+    float l;
+
+    while (fgets(line, 1024, fpDataFile))
+    {
+        if (5 == sscanf(line, "%f,%f,%f,%f,%f[^\n]", &feat[index * cols + 0],
+                        &feat[index * cols + 1], &feat[index * cols + 2],
+                        &feat[index * cols + 3], &l))
+        {
+            label[index * out_cols + ((int)l)] = 1;
+            index++;
+        }
+    }
+    fclose(fpDataFile);
+}
+
+inline void shuffle(int *array, int n)
+{
+    if (n > 1)
+    {
+        int i;
+        for (i = 0; i < n - 1; i++)
+        {
+            int j = i + rand() / (RAND_MAX / (n - i) + 1);
+            int t = array[j];
+            array[j] = array[i];
+            array[i] = t;
+        }
+    }
+}
+
+inline bool matches(float const prediction[], float const answer[])
+{
+    for (int k = 0; k < out_cols; ++k)
+    {
+        if (fabsf(prediction[k] - answer[k]) >= 0.1f)
+            return false;
+    }
+    return true;
+}
+
+// Whether the largest output is the labelled class.
+inline bool argmax_matches(float const prediction[], float const answer[])
+{
+    int best = 0;
+    for (int k = 1; k < out_cols; ++k)
+    {
+        if (prediction[k] > prediction[best])
+            best = k;
+    }
+    return answer[best] == 1;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include "iris.hpp"
+#include "serving.hpp"
+#include <algorithm>
+#include <thread>
+
+// Load generator for server.cpp. Every connection keeps `depth` requests in flight,
+// sending Iris rows, and the run reports throughput and the latency distribution.
+//
+//   ./load_client [endpoint] [connections] [requests_per_connection] [depth]
+
+namespace srv = meta_ai::serving;
+
+float feat[rows * cols];
+float label[rows * out_cols];
+
+struct request_frame
+{
+    srv::request_header header;
+    float input[cols];
+};
+
+void run_connection(srv::endpoint ep, int requests, int depth, std::vector<double> *latencies, bool *failed)
+{
+    using clock = std::chrono::steady_clock;
+
+    int fd = srv::connect_to(ep);
+    if (fd < 0)
+    {
+        *failed = true;
+        return;
+    }
+
+    std::vector<clock::time_point> sent_at(requests);
+    latencies->reserve(requests);
+
+    auto send = [&](int id)
+    {
+        request_frame frame;
+        frame.header = {(uint32_t)id, cols, 0};
+        memcpy(frame.input, feat + (id % rows) * cols, sizeof(frame.input));
+        sent_at[id] = clock::now();
+        return srv::write_full(fd, &frame, sizeof(frame));
+    };
+
+    int next = 0;
+    while (next < requests && next < depth)
+    {
+        if (!send(next++))
+            *failed = true;
+    }
+
+    srv::response_header header;
+    float output[out_cols];
+    for (int received = 0; received < requests && !*failed; ++received)
+    {
+        // A response of another shape, or for a request never sent, ends the connection.
+        if (!srv::read_full(fd, &header, sizeof(header)) ||
+            header.status != srv::STATUS_OK ||
+            header.n_values != out_cols ||
+            header.id >= (uint32_t)next ||
+            !srv::read_full(fd, output, sizeof(output)))
+        {
+            *failed = true;
+            break;
+        }
+        latencies->push_back(std::chrono::duration<double, std::micro>(clock::now() - sent_at[header.id]).count());
+
+        if (next < requests && !send(next++))
+            *failed = true;
+    }
+
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    char const *spec = argc > 1 ? argv[1] : "unix:/tmp/meta_ai.sock";
+    int const connections = argc > 2 ? atoi(argv[2]) : 4;
+    int const requests = argc > 3 ? atoi(argv[3]) : 50000;
+    int const depth = argc > 4 ? atoi(argv[4]) : 16;
+
+    srv::endpoint ep;
+    if (!srv::parse_endpoint(spec, ep))
+    {
+        printf("Bad endpoint: %s\n", spec);
+        return EXIT_FAILURE;
+    }
+
+    readIris(feat, label);
+
+    std::vector<std::vector<double>> latencies(connections);
+    std::unique_ptr<bool[]> failed(new bool[connections]());
+    std::vector<std::thread> clients;
+
+    auto const start = std::chrono::steady_clock::now();
+    for (int c = 0; c < connections; ++c)
+        clients.emplace_back(run_connection, ep, requests, depth, &latencies[c], &failed[c]);
+    for (auto &client : clients)
+        client.join();
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (int c = 0; c < connections; ++c)
+    {
+        if (failed[c])
+            printf("Connection %d failed\n", c);
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+    }
+    if (all.empty())
+        return EXIT_FAILURE;
+
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p)
+    { return all[std::min(all.size() - 1, (std::size_t)(p * all.size()))]; };
+
+    double mean = 0;
+    for (double l : all)
+        mean += l;
+    mean /= all.size();
+
+    printf("%zu requests over %d connections (depth %d) in %.3f s\n", all.size(), connections, depth, seconds);
+    printf("QPS %.0f\n", all.size() / seconds);
+    printf("latency us: mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           mean, percentile(0.50), percentile(0.90), percentile(0.99), percentile(0.999), all.back());
+
+    return EXIT_SUCCESS;
+}
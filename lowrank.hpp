@@ -0,0 +1,289 @@
+#ifndef __LOWRANK_H__
+#define __LOWRANK_H__
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include "mlp.hpp"
+
+// Low-rank factorization of a trained MLP and an inference engine for the result.
+//
+// The input weights W (outputs x inputs) of every layer are replaced by A * B, with A
+// outputs x r and B r x inputs, from the r largest singular values of W: W x costs
+// r * (inputs + outputs) multiply-adds instead of inputs * outputs. The bias column
+// is kept exact. The decomposition comes from the eigenvectors of the smaller Gram
+// matrix (W W^T or W^T W), found with cyclic Jacobi rotations in double precision;
+// squaring the matrix only costs accuracy on the small singular values, which are the
+// ones truncated anyway.
+
+namespace meta_ai
+{
+    namespace detail
+    {
+        // Eigen-decomposition of the symmetric n x n row-major matrix a, destroyed in the
+        // process. Returns the eigenvalues in descending order and, in vectors, the matching
+        // unit eigenvectors as columns (n x n row-major).
+        inline std::vector<double> symmetric_eigen(std::vector<double> &a, std::size_t n, std::vector<double> &vectors)
+        {
+            std::vector<double> v(n * n, 0);
+            for (std::size_t i = 0; i < n; ++i)
+                v[i * n + i] = 1;
+
+            double norm = 0;
+            for (double x : a)
+                norm += x * x;
+
+            for (int sweep = 0; sweep < 64; ++sweep)
+            {
+                double off = 0;
+                for (std::size_t p = 0; p < n; ++p)
+                    for (std::size_t q = p + 1; q < n; ++q)
+                        off += a[p * n + q] * a[p * n + q];
+                if (off <= 1e-24 * norm)
+                    break;
+
+                for (std::size_t p = 0; p < n; ++p)
+                {
+                    for (std::size_t q = p + 1; q < n; ++q)
+                    {
+                        double const apq = a[p * n + q];
+                        if (apq * apq <= 1e-30 * norm)
+                            continue;
+                        double const theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+                        double const t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+                        double const c = 1 / sqrt(t * t + 1), s = t * c;
+
+                        for (std::size_t k = 0; k < n; ++k)
+                        {
+                            double const akp = a[k * n + p], akq = a[k * n + q];
+                            a[k * n + p] = c * akp - s * akq;
+                            a[k * n + q] = s * akp + c * akq;
+                        }
+                        for (std::size_t k = 0; k < n; ++k)
+                        {
+                            double const apk = a[p * n + k], aqk = a[q * n + k];
+                            a[p * n + k] = c * apk - s * aqk;
+                            a[q * n + k] = s * apk + c * aqk;
+                        }
+                        for (std::size_t k = 0; k < n; ++k)
+                        {
+                            double const vkp = v[k * n + p], vkq = v[k * n + q];
+                            v[k * n + p] = c * vkp - s * vkq;
+                            v[k * n + q] = s * vkp + c * vkq;
+                        }
+                    }
+                }
+            }
+
+            std::vector<std::size_t> order(n);
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y)
+                      { return a[x * n + x] > a[y * n + y]; });
+
+            std::vector<double> values(n);
+            vectors.assign(n * n, 0);
+            for (std::size_t j = 0; j < n; ++j)
+            {
+                values[j] = std::max(0.0, a[order[j] * n + order[j]]);
+                for (std::size_t k = 0; k < n; ++k)
+                    vectors[k * n + j] = v[k * n + order[j]];
+            }
+            return values;
+        }
+    };
+
+    // How much of each layer to keep. A layer keeps the fewest singular values whose
+    // squares add up to `energy` of its squared Frobenius norm, at most max_rank of them
+    // (0: no limit). Layers where the factored form would not save multiplies stay dense.
+    struct lowrank_config
+    {
+        double energy = 0.99;
+        std::size_t max_rank = 0;
+    };
+
+    template <typename float_t>
+    class LowRankMLP
+    {
+        struct factored_layer
+        {
+            std::size_t inputs;
+            std::size_t outputs;
+            std::size_t rank;        // == 0: dense, weights in a (outputs x inputs)
+            double energy;           // fraction of the squared norm kept
+            std::vector<float_t> a;  // outputs x rank
+            std::vector<float_t> b;  // rank x inputs
+            std::vector<float_t> bias;
+        };
+
+        std::vector<factored_layer> layers;
+        std::vector<float_t> activations[2];
+        std::vector<float_t> projected;
+
+        template <typename L>
+        static factored_layer factor(L const &layer, lowrank_config const &config)
+        {
+            factored_layer f;
+            std::size_t const m = layer.size(), n = layer.inputs();
+            f.inputs = n;
+            f.outputs = m;
+
+            std::vector<double> w(m * n);
+            for (std::size_t i = 0; i < m; ++i)
+            {
+                float_t const *row = layer.get_weights().begin()[i].begin();
+                std::copy(row, row + n, w.begin() + i * n);
+                f.bias.push_back(row[n]);
+            }
+
+            // Gram matrix of the smaller side: W W^T when m <= n, else W^T W.
+            bool const tall = m > n;
+            std::size_t const k = tall ? n : m;
+            std::vector<double> gram(k * k, 0);
+            for (std::size_t p = 0; p < k; ++p)
+                for (std::size_t q = p; q < k; ++q)
+                {
+                    double sum = 0;
+                    if (tall)
+                        for (std::size_t i = 0; i < m; ++i)
+                            sum += w[i * n + p] * w[i * n + q];
+                    else
+                        for (std::size_t j = 0; j < n; ++j)
+                            sum += w[p * n + j] * w[q * n + j];
+                    gram[p * k + q] = gram[q * k + p] = sum;
+                }
+
+            std::vector<double> vectors;
+            std::vector<double> const values = detail::symmetric_eigen(gram, k, vectors);
+            double const total = std::accumulate(values.begin(), values.end(), 0.0);
+
+            std::size_t r = 0;
+            double kept = 0;
+            std::size_t const limit = config.max_rank ? std::min(config.max_rank, k) : k;
+            while (r < limit && (r == 0 || kept < config.energy * total))
+                kept += values[r++];
+
+            f.energy = total > 0 ? kept / total : 1;
+            if (r * (m + n) >= m * n)
+            {
+                f.rank = 0;
+                f.energy = 1;
+                f.a.assign(w.begin(), w.end());
+                return f;
+            }
+
+            // Wide: A = U_r, B = U_r^T W. Tall: A = W V_r, B = V_r^T.
+            f.rank = r;
+            f.a.assign(m * r, 0);
+            f.b.assign(r * n, 0);
+            for (std::size_t c = 0; c < r; ++c)
+            {
+                if (tall)
+                {
+                    for (std::size_t j = 0; j < n; ++j)
+                        f.b[c * n + j] = vectors[j * k + c];
+                    for (std::size_t i = 0; i < m; ++i)
+                    {
+                        double sum = 0;
+                        for (std::size_t j = 0; j < n; ++j)
+                            sum += w[i * n + j] * vectors[j * k + c];
+                        f.a[i * r + c] = sum;
+                    }
+                }
+                else
+                {
+                    for (std::size_t i = 0; i < m; ++i)
+                        f.a[i * r + c] = vectors[i * k + c];
+                    for (std::size_t j = 0; j < n; ++j)
+                    {
+                        double sum = 0;
+                        for (std::size_t i = 0; i < m; ++i)
+                            sum += vectors[i * k + c] * w[i * n + j];
+                        f.b[c * n + j] = sum;
+                    }
+                }
+            }
+            return f;
+        }
+
+        static void dot_rows(float_t const *matrix, std::size_t n_rows, std::size_t n_cols, float_t const *x, float_t *y)
+        {
+            for (std::size_t i = 0; i < n_rows; ++i)
+            {
+                float_t const *row = matrix + i * n_cols;
+                float_t sum = 0;
+                for (std::size_t j = 0; j < n_cols; ++j)
+                    sum += row[j] * x[j];
+                y[i] = sum;
+            }
+        }
+
+    public:
+        template <typename Model>
+        explicit LowRankMLP(Model const &model, lowrank_config const &config = {})
+        {
+            std::size_t widest = 0, widest_rank = 0;
+            model.for_each_layer([&](auto const &layer)
+                                 {
+                                     layers.push_back(factor(layer, config));
+                                     widest = std::max({widest, layer.inputs(), layer.size()});
+                                     widest_rank = std::max(widest_rank, layers.back().rank); });
+            activations[0].assign(widest, 0);
+            activations[1].assign(widest, 0);
+            projected.assign(widest_rank, 0);
+        }
+
+        std::size_t depth() const { return layers.size(); }
+
+        // Kept singular values of layer l; 0 when it stayed dense.
+        std::size_t rank(std::size_t l) const { return layers[l].rank; }
+
+        // Fraction of layer l's squared Frobenius norm the factors keep.
+        double energy(std::size_t l) const { return layers[l].energy; }
+
+        std::size_t bytes() const
+        {
+            std::size_t n = 0;
+            for (auto const &l : layers)
+                n += (l.a.size() + l.b.size() + l.bias.size()) * sizeof(float_t);
+            return n;
+        }
+
+        // Multiply-adds per prediction, bias included.
+        std::size_t flops() const
+        {
+            std::size_t n = 0;
+            for (auto const &l : layers)
+                n += l.a.size() + l.b.size() + l.outputs;
+            return n;
+        }
+
+        void predict(float_t const input[], float_t output[])
+        {
+            float_t *in = activations[0].data();
+            float_t *out = activations[1].data();
+            std::copy(input, input + layers.front().inputs, in);
+
+            for (auto const &l : layers)
+            {
+                if (l.rank)
+                {
+                    dot_rows(l.b.data(), l.rank, l.inputs, in, projected.data());
+                    dot_rows(l.a.data(), l.outputs, l.rank, projected.data(), out);
+                }
+                else
+                {
+                    dot_rows(l.a.data(), l.outputs, l.inputs, in, out);
+                }
+                for (std::size_t i = 0; i < l.outputs; ++i)
+                    out[i] = 1 / (1 + ((float_t)(exp(-(out[i] + l.bias[i])))));
+                std::swap(in, out);
+            }
+
+            std::copy(in, in + layers.back().outputs, output);
+        }
+    };
+};
+
+#endif
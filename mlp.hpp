@@ -2,8 +2,15 @@
 #define __MLP_H__
 
 #include <tuple>
+#include <stdint.h>
+#include <array>
+#include <algorithm>
+#include <new>
+#include <type_traits>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <sys/mman.h>
 #include "pure_simd.hpp"
 
 /*
@@ -35,14 +42,373 @@ namespace meta_ai
 #define FAST_RAND_MAX 32767
     static unsigned int g_seed = 5;
 
+    // Seeds fast_rand, and with it the initial weights of the models built afterwards.
+    inline void fast_srand(unsigned int seed)
+    {
+        g_seed = seed;
+    }
+
+    // The same recurrence on a caller's state, for code that must not share g_seed, e.g.
+    // jobs initializing models on several threads (MLP::uniform_init, cross_validate).
+    inline int fast_rand(unsigned int &seed)
+    {
+        seed = (214013 * seed + 2531011);
+        return (seed >> 16) & 0x7FFF;
+    }
+
     inline int fast_rand(void)
     {
-        g_seed = (214013 * g_seed + 2531011);
-        return (g_seed >> 16) & 0x7FFF;
+        return fast_rand(g_seed);
     }
 
     namespace simd = pure_simd;
 
+#ifndef WIDE_LAYER_THRESHOLD
+// Layers with at least this many inputs or outputs are built as WideLayer: loop-based
+// kernels over heap storage instead of pure_simd vectors unrolled over the full width.
+#define WIDE_LAYER_THRESHOLD 512
+#endif
+
+// Columns per tile of the wide kernels: 1024 floats of input stay in L1 while weight rows stream past.
+#define WIDE_TILE 1024
+
+#ifndef INTRA_OP_MIN_MACS
+// Wide layers with fewer weights than this never split a pass across threads: for them
+// the barrier at the end of the pass costs more than the work it would share.
+#define INTRA_OP_MIN_MACS (1 << 16)
+#endif
+
+    namespace detail
+    {
+        constexpr std::size_t HUGE_PAGE = 2 << 20;
+
+        // Zeroed, cache-line aligned heap memory. Blocks of at least one huge page are
+        // huge-page aligned and advised for transparent huge pages, so a wide weight matrix
+        // costs a handful of TLB entries instead of one per 4 KiB.
+        inline void *alloc_wide(std::size_t bytes)
+        {
+            std::size_t const align = bytes >= HUGE_PAGE ? HUGE_PAGE : 64;
+            bytes = (bytes + align - 1) / align * align;
+            void *p = nullptr;
+            if (posix_memalign(&p, align, bytes) != 0)
+            {
+                throw std::bad_alloc();
+            }
+#ifdef MADV_HUGEPAGE
+            if (align == HUGE_PAGE)
+            {
+                madvise(p, bytes, MADV_HUGEPAGE);
+            }
+#endif
+            memset(p, 0, bytes);
+            return p;
+        }
+    };
+
+    // Fixed-size vector on the heap, for activations of wide layers. Copies are deep.
+    template <typename float_t, std::size_t N>
+    class wide_vector
+    {
+        float_t *values;
+
+    public:
+        wide_vector() : values((float_t *)detail::alloc_wide(N * sizeof(float_t))) {}
+        wide_vector(wide_vector const &other) : wide_vector() { memcpy(values, other.values, N * sizeof(float_t)); }
+        wide_vector &operator=(wide_vector const &other)
+        {
+            memmove(values, other.values, N * sizeof(float_t));
+            return *this;
+        }
+        ~wide_vector() { free(values); }
+
+        static constexpr std::size_t size() { return N; }
+        float_t &operator[](std::size_t i) { return values[i]; }
+        float_t const &operator[](std::size_t i) const { return values[i]; }
+        float_t *begin() { return values; }
+        float_t *end() { return values + N; }
+        float_t const *begin() const { return values; }
+        float_t const *end() const { return values + N; }
+    };
+
+    // ROWS x COLS matrix on the heap, rows padded to whole cache lines. Indexing yields
+    // row views with the same begin()/operator[] interface as a pure_simd row, so
+    // weights[j][i] and weights.begin()[j].begin() work on either layer kind.
+    template <typename float_t, std::size_t ROWS, std::size_t COLS>
+    class wide_matrix
+    {
+    public:
+        static constexpr std::size_t STRIDE = (COLS * sizeof(float_t) + 63) / 64 * 64 / sizeof(float_t);
+
+        template <typename T>
+        struct row
+        {
+            T *first;
+
+            static constexpr std::size_t size() { return COLS; }
+            T &operator[](std::size_t k) const { return first[k]; }
+            T *begin() const { return first; }
+            T *end() const { return first + COLS; }
+        };
+
+        template <typename T>
+        struct row_iterator
+        {
+            T *first;
+
+            row<T> operator*() const { return {first}; }
+            row<T> operator[](std::size_t i) const { return {first + i * STRIDE}; }
+            row_iterator &operator++()
+            {
+                first += STRIDE;
+                return *this;
+            }
+            bool operator!=(row_iterator const &other) const { return first != other.first; }
+        };
+
+    private:
+        float_t *values;
+
+    public:
+        wide_matrix() : values((float_t *)detail::alloc_wide(ROWS * STRIDE * sizeof(float_t))) {}
+        wide_matrix(wide_matrix const &other) : wide_matrix() { memcpy(values, other.values, ROWS * STRIDE * sizeof(float_t)); }
+        wide_matrix &operator=(wide_matrix const &other)
+        {
+            memmove(values, other.values, ROWS * STRIDE * sizeof(float_t));
+            return *this;
+        }
+        ~wide_matrix() { free(values); }
+
+        static constexpr std::size_t size() { return ROWS; }
+        float_t *data() { return values; }
+        float_t const *data() const { return values; }
+        row<float_t> operator[](std::size_t i) { return {values + i * STRIDE}; }
+        row<float_t const> operator[](std::size_t i) const { return {values + i * STRIDE}; }
+        row_iterator<float_t> begin() { return {values}; }
+        row_iterator<float_t> end() { return {values + ROWS * STRIDE}; }
+        row_iterator<float_t const> begin() const { return {values}; }
+        row_iterator<float_t const> end() const { return {values + ROWS * STRIDE}; }
+    };
+
+    // Activation storage of WIDTH values plus BIAS lanes: unrolled pure_simd vector below the
+    // threshold, heap from it on. The width alone decides, as it does for is_wide_layer, so
+    // a WideLayer's outputs are on the heap whether or not they carry a bias lane.
+    template <typename float_t, std::size_t WIDTH, std::size_t BIAS = 0>
+    using activations_t = std::conditional_t<(WIDTH >= WIDE_LAYER_THRESHOLD), wide_vector<float_t, WIDTH + BIAS>, simd::vector<float_t, WIDTH + BIAS>>;
+
+    // Forward kernel variants a perceptron layer can be switched to at run time, e.g. by
+    // the autotuner (autotune.hpp). Variant 0 is the layer's built-in kernel: unrolled
+    // pure_simd for small layers, 4 rows by WIDE_TILE for wide ones. Variant v > 0 is the
+    // looped kernel with kernel_rows(v) rows per block and kernel_tile(v) columns per tile.
+    constexpr std::size_t KERNEL_ROWS[] = {1, 2, 4, 8};
+    constexpr std::size_t KERNEL_TILES[] = {256, 1024, 4096};
+    constexpr std::size_t N_KERNEL_ROWS = sizeof(KERNEL_ROWS) / sizeof(KERNEL_ROWS[0]);
+    constexpr std::size_t N_KERNEL_TILES = sizeof(KERNEL_TILES) / sizeof(KERNEL_TILES[0]);
+    constexpr std::size_t KERNEL_VARIANTS = 1 + N_KERNEL_ROWS * N_KERNEL_TILES;
+
+    constexpr std::size_t kernel_rows(std::size_t v) { return KERNEL_ROWS[(v - 1) / N_KERNEL_TILES]; }
+    constexpr std::size_t kernel_tile(std::size_t v) { return KERNEL_TILES[(v - 1) % N_KERNEL_TILES]; }
+
+    // Kernel variant used by a layer for single-sample feeds and for feed_batch.
+    struct kernel_choice
+    {
+        uint8_t feed = 0;
+        uint8_t batch = 0;
+    };
+
+    // Runs body(arg, begin, end) over chunks of [0, n), cut at multiples of grain, possibly
+    // on several threads, and returns once every chunk is done. Wide layers given one
+    // (set_executor) split their passes through it; IntraOpPool (intra_op.hpp) implements it.
+    class parallel_executor
+    {
+    public:
+        using body_t = void (*)(void *arg, std::size_t begin, std::size_t end);
+        virtual void run(std::size_t n, std::size_t grain, body_t body, void *arg) = 0;
+
+    protected:
+        ~parallel_executor() = default;
+    };
+
+    namespace detail
+    {
+        // out[i] = sum_k w[i][k] * x[k]. Columns are walked in TILE slices so the slice of
+        // x stays in L1, and ROWS rows (ROWS independent sums) share every load of it.
+        template <std::size_t ROWS, std::size_t TILE, typename float_t>
+        void wide_gemv(float_t const *w, std::size_t stride, std::size_t rows, std::size_t cols, float_t const *x, float_t *out)
+        {
+            std::fill(out, out + rows, float_t{0});
+            for (std::size_t k0 = 0; k0 < cols; k0 += TILE)
+            {
+                std::size_t const k1 = std::min(cols, k0 + TILE);
+                for (std::size_t i = 0; i < rows; i += ROWS)
+                {
+                    std::size_t const r = std::min(ROWS, rows - i);
+                    float_t const *wr[ROWS];
+                    float_t sums[ROWS] = {};
+                    for (std::size_t q = 0; q < ROWS; ++q)
+                    {
+                        wr[q] = w + (i + (q < r ? q : 0)) * stride;
+                    }
+                    for (std::size_t k = k0; k < k1; ++k)
+                    {
+                        for (std::size_t q = 0; q < ROWS; ++q)
+                        {
+                            sums[q] += wr[q][k] * x[k];
+                        }
+                    }
+                    for (std::size_t q = 0; q < r; ++q)
+                    {
+                        out[i + q] += sums[q];
+                    }
+                }
+            }
+        }
+
+        // The batched form: outs[b][i] = sum_k w[i][k] * inputs[b][k] for n samples. A ROWS
+        // by TILE block of weights is brought into cache once and reused by every sample.
+        template <std::size_t ROWS, std::size_t TILE, typename float_t, typename X, typename Y>
+        void wide_gemm(float_t const *w, std::size_t stride, std::size_t rows, std::size_t cols, X const inputs[], Y outs[], std::size_t n)
+        {
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                std::fill(outs[b].begin(), outs[b].begin() + rows, float_t{0});
+            }
+            for (std::size_t k0 = 0; k0 < cols; k0 += TILE)
+            {
+                std::size_t const k1 = std::min(cols, k0 + TILE);
+                for (std::size_t i = 0; i < rows; i += ROWS)
+                {
+                    std::size_t const r = std::min(ROWS, rows - i);
+                    float_t const *wr[ROWS];
+                    for (std::size_t q = 0; q < ROWS; ++q)
+                    {
+                        wr[q] = w + (i + (q < r ? q : 0)) * stride;
+                    }
+                    for (std::size_t b = 0; b < n; ++b)
+                    {
+                        float_t const *x = inputs[b].begin();
+                        float_t sums[ROWS] = {};
+                        for (std::size_t k = k0; k < k1; ++k)
+                        {
+                            for (std::size_t q = 0; q < ROWS; ++q)
+                            {
+                                sums[q] += wr[q][k] * x[k];
+                            }
+                        }
+                        float_t *y = outs[b].begin() + i;
+                        for (std::size_t q = 0; q < r; ++q)
+                        {
+                            y[q] += sums[q];
+                        }
+                    }
+                }
+            }
+        }
+
+        template <typename float_t>
+        using gemv_t = void (*)(float_t const *, std::size_t, std::size_t, std::size_t, float_t const *, float_t *);
+
+        template <typename float_t, typename X, typename Y>
+        using gemm_t = void (*)(float_t const *, std::size_t, std::size_t, std::size_t, X const[], Y[], std::size_t);
+
+        template <typename float_t, std::size_t... V>
+        constexpr std::array<gemv_t<float_t>, KERNEL_VARIANTS> make_gemv_table(std::index_sequence<V...>)
+        {
+            return {nullptr, &wide_gemv<kernel_rows(V + 1), kernel_tile(V + 1), float_t>...};
+        }
+
+        template <typename float_t, typename X, typename Y, std::size_t... V>
+        constexpr std::array<gemm_t<float_t, X, Y>, KERNEL_VARIANTS> make_gemm_table(std::index_sequence<V...>)
+        {
+            return {nullptr, &wide_gemm<kernel_rows(V + 1), kernel_tile(V + 1), float_t, X, Y>...};
+        }
+
+        // Entry v is variant v; entry 0 is empty, layers run their built-in kernel for it.
+        template <typename float_t>
+        inline constexpr auto gemv_table = make_gemv_table<float_t>(std::make_index_sequence<KERNEL_VARIANTS - 1>{});
+
+        template <typename float_t, typename X, typename Y>
+        inline constexpr auto gemm_table = make_gemm_table<float_t, X, Y>(std::make_index_sequence<KERNEL_VARIANTS - 1>{});
+
+        // body(begin, end) over [0, n): through executor when there is one, inline otherwise.
+        template <typename F>
+        void parallel_for(parallel_executor *executor, std::size_t n, std::size_t grain, F &&body)
+        {
+            if (!executor)
+            {
+                body(std::size_t{0}, n);
+                return;
+            }
+            using body_ref = std::remove_reference_t<F>;
+            executor->run(n, grain, [](void *arg, std::size_t begin, std::size_t end)
+                          { (*static_cast<body_ref *>(arg))(begin, end); },
+                          (void *)&body);
+        }
+
+        // Stateless backward pass shared by every perceptron layer kind; W and G are the
+        // layer's weights and gradient, rows reached through begin()[i].begin(). errs[b] holds
+        // the error at the layer's outputs for sample b and is turned into its deltas in
+        // place; G accumulates sum_b deltas[b] x inputs[b], and back[b] (when given) receives
+        // W^T deltas[b], the error at the previous layer's outputs.
+        template <std::size_t INPUTS, std::size_t OUTPUTS, typename W, typename G, typename V, typename O>
+        void backward_rows(W const &weights, V const inputs[], O const outs[], O errs[], G &grad, V back[], std::size_t n)
+        {
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                auto *d = errs[b].begin();
+                auto const *out = outs[b].begin();
+                for (std::size_t i = 0; i < OUTPUTS; ++i)
+                {
+                    d[i] *= out[i] * (1 - out[i]);
+                }
+            }
+            for (std::size_t i = 0; i < OUTPUTS; ++i)
+            {
+                auto *g = grad.begin()[i].begin();
+                for (std::size_t b = 0; b < n; ++b)
+                {
+                    auto const *x = inputs[b].begin();
+                    auto const d = errs[b][i];
+                    for (std::size_t k = 0; k < INPUTS + 1; ++k)
+                    {
+                        g[k] += d * x[k];
+                    }
+                }
+            }
+            if (!back)
+                return;
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                auto *e = back[b].begin();
+                std::fill(e, e + INPUTS, 0);
+                for (std::size_t i = 0; i < OUTPUTS; ++i)
+                {
+                    auto const *w = weights.begin()[i].begin();
+                    auto const d = errs[b][i];
+                    for (std::size_t k = 0; k < INPUTS; ++k)
+                    {
+                        e[k] += d * w[k];
+                    }
+                }
+            }
+        }
+
+        // weights += rate * grad, then grad = 0.
+        template <std::size_t INPUTS, std::size_t OUTPUTS, typename W, typename G, typename float_t>
+        void apply_rows(W &weights, G &grad, float_t rate)
+        {
+            for (std::size_t i = 0; i < OUTPUTS; ++i)
+            {
+                float_t *w = weights.begin()[i].begin();
+                float_t *g = grad.begin()[i].begin();
+                for (std::size_t k = 0; k < INPUTS + 1; ++k)
+                {
+                    w[k] += rate * g[k];
+                    g[k] = 0;
+                }
+            }
+        }
+    };
+
     template <std::size_t... Is>
     constexpr auto indexSequenceReverse(std::index_sequence<Is...> const &)
         -> decltype(std::index_sequence<sizeof...(Is) - 1U - Is...>{});
@@ -68,7 +434,11 @@ namespace meta_ai
     template <typename float_t, std::size_t OUTPUTS>
     class Layer<float_t, INPUT<OUTPUTS>>
     {
-        simd::vector<float_t, OUTPUTS + 1> outputs;
+    public:
+        using outputs_t = activations_t<float_t, OUTPUTS, 1>;
+
+    private:
+        outputs_t outputs;
 
     public:
         Layer()
@@ -95,15 +465,43 @@ namespace meta_ai
     template <typename float_t, std::size_t INPUTS, std::size_t OUTPUTS>
     class Layer<float_t, HIDDEN<INPUTS>, HIDDEN<OUTPUTS>>
     {
-        simd::vector<simd::vector<float_t, INPUTS + 1>, OUTPUTS> weights;
-        simd::vector<float_t, OUTPUTS + 1> outputs;
-        simd::vector<float_t, OUTPUTS + 1> deltas;
+    public:
+        using outputs_t = simd::vector<float_t, OUTPUTS + 1>;
+
+        using row_t = simd::vector<float_t, INPUTS + 1>;
+        using gradient_t = simd::vector<row_t, OUTPUTS>;
+
+    private:
+        simd::vector<row_t, OUTPUTS> weights;
+        outputs_t outputs;
+        outputs_t deltas;
+        kernel_choice kernels;
+
+        static constexpr std::size_t STRIDE = sizeof(row_t) / sizeof(float_t);
+
+        // Looped variant kernels.batch in place of the unrolled batch loop.
+        template <typename V>
+        void batch_kernel(V const inputs[], outputs_t outs[], std::size_t n) const
+        {
+            detail::gemm_table<float_t, V, outputs_t>[kernels.batch](weights.begin()->begin(), STRIDE, OUTPUTS, INPUTS + 1, inputs, outs, n);
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                for (int i = 0; i < OUTPUTS; ++i)
+                {
+                    outs[b][i] = 1 / (1 + ((float_t)(exp(-outs[b][i]))));
+                }
+            }
+        }
 
     public:
         static constexpr std::size_t size() { return OUTPUTS; }
+        static constexpr std::size_t inputs() { return INPUTS; }
         auto const &get_weights() const { return weights; }
+        auto &get_weights() { return weights; }
         auto const &get_outputs() const { return outputs; }
         auto const &get_deltas() const { return deltas; }
+        kernel_choice get_kernels() const { return kernels; }
+        void set_kernels(kernel_choice choice) { kernels = choice; }
 
         Layer()
         {
@@ -121,26 +519,66 @@ namespace meta_ai
             outputs[OUTPUTS] = 1;
         }
 
+        // Sets the outputs as if feed had computed them, e.g. from cached activations
+        // (FrozenPrefixTrainer, freeze.hpp). The bias lane stays 1.
+        void load(float_t const values[])
+        {
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                outputs[i] = values[i];
+            }
+        }
+
         template <typename L>
         void feed(L const &prev_layer)
         {
             auto const &inputs = prev_layer.get_outputs();
+            if (kernels.feed)
+            {
+                detail::gemv_table<float_t>[kernels.feed](weights.begin()->begin(), STRIDE, OUTPUTS, INPUTS + 1, inputs.begin(), outputs.begin());
+            }
             for (int i = 0; i < OUTPUTS; ++i)
             {
-                outputs[i] = simd::sum(inputs * weights[i], float_t{0});
+                if (!kernels.feed)
+                {
+                    outputs[i] = simd::sum(simd::lazy(inputs) * weights[i], float_t{0});
+                }
                 outputs[i] = 1 / (1 + ((float_t)(exp(-outputs[i]))));
             }
         }
 
-        template <typename L1, typename L2>
-        void tune(L1 const &prev_layer, L2 const &next_layer, float_t rate)
+        // Stateless forward over n samples held by the caller. Each neuron's weights are
+        // loaded once and reused for the whole batch.
+        template <typename V>
+        void feed_batch(V const inputs[], outputs_t outs[], std::size_t n) const
+        {
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                outs[b][OUTPUTS] = 1;
+            }
+            if (kernels.batch)
+            {
+                batch_kernel(inputs, outs, n);
+                return;
+            }
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                auto const &neuron_weights = weights[i];
+                for (std::size_t b = 0; b < n; ++b)
+                {
+                    float_t const sum = simd::sum(simd::lazy(inputs[b]) * neuron_weights, float_t{0});
+                    outs[b][i] = 1 / (1 + ((float_t)(exp(-sum))));
+                }
+            }
+        }
+
+        template <typename L>
+        void compute_deltas(L const &next_layer)
         {
             auto constexpr next_size = next_layer.size();
 
             auto const &next_weights = next_layer.get_weights();
-            auto const &next_outputs = next_layer.get_outputs();
             auto const &next_deltas = next_layer.get_deltas();
-            auto const &inputs = prev_layer.get_outputs();
 
             for (int i = 0; i < OUTPUTS; ++i)
             {
@@ -152,28 +590,107 @@ namespace meta_ai
             }
 
             deltas = deltas * (outputs * (simd::scalar<decltype(outputs)>(1) - outputs));
+        }
+
+        template <typename L1, typename L2>
+        void tune(L1 const &prev_layer, L2 const &next_layer, float_t rate)
+        {
+            auto const &inputs = prev_layer.get_outputs();
+
+            compute_deltas(next_layer);
 
             auto const delta_rate = simd::scalar<decltype(deltas)>(rate) * deltas;
 
             for (int i = 0; i < OUTPUTS; ++i)
             {
-                weights[i] = weights[i] + inputs * simd::scalar<typename std::remove_const<typename std::remove_reference<decltype(inputs)>::type>::type>(delta_rate[i]);
+                simd::assign(weights[i], simd::lazy(weights[i]) + inputs * simd::broadcast<row_t>(delta_rate[i]));
+            }
+        }
+
+        // Sparse input: only the nnz (index, value) pairs are non-zero. The cost is
+        // OUTPUTS * nnz instead of OUTPUTS * INPUTS, and only those columns are updated.
+        void feed_sparse(uint32_t const index[], float_t const value[], std::size_t nnz)
+        {
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                float_t const *neuron_weights = weights.begin()[i].begin();
+                float_t sum = neuron_weights[INPUTS];
+                for (std::size_t k = 0; k < nnz; ++k)
+                {
+                    sum += neuron_weights[index[k]] * value[k];
+                }
+                outputs[i] = 1 / (1 + ((float_t)(exp(-sum))));
+            }
+        }
+
+        template <typename L>
+        void tune_sparse(uint32_t const index[], float_t const value[], std::size_t nnz, L const &next_layer, float_t rate)
+        {
+            compute_deltas(next_layer);
+
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                float_t const delta_rate = rate * deltas[i];
+                float_t *neuron_weights = weights.begin()[i].begin();
+                for (std::size_t k = 0; k < nnz; ++k)
+                {
+                    neuron_weights[index[k]] += value[k] * delta_rate;
+                }
+                neuron_weights[INPUTS] += delta_rate;
             }
         }
+
+        // Mini-batch training without the layer's own activations: see detail::backward_rows.
+        // The gradient is a zero-initialized gradient_t (new gradient_t()) owned by the caller.
+        template <typename V>
+        void backward_batch(V const inputs[], outputs_t const outs[], outputs_t errs[], gradient_t &grad, V back[], std::size_t n) const
+        {
+            detail::backward_rows<INPUTS, OUTPUTS>(weights, inputs, outs, errs, grad, back, n);
+        }
+
+        void apply_gradient(gradient_t &grad, float_t rate) { detail::apply_rows<INPUTS, OUTPUTS>(weights, grad, rate); }
     };
 
     template <typename float_t, std::size_t INPUTS, std::size_t OUTPUTS>
     class Layer<float_t, HIDDEN<INPUTS>, OUTPUT<OUTPUTS>>
     {
-        simd::vector<simd::vector<float_t, INPUTS + 1>, OUTPUTS> weights;
-        simd::vector<float_t, OUTPUTS> outputs;
-        simd::vector<float_t, OUTPUTS> deltas;
+    public:
+        using outputs_t = simd::vector<float_t, OUTPUTS>;
+
+        using row_t = simd::vector<float_t, INPUTS + 1>;
+        using gradient_t = simd::vector<row_t, OUTPUTS>;
+
+    private:
+        simd::vector<row_t, OUTPUTS> weights;
+        outputs_t outputs;
+        outputs_t deltas;
+        kernel_choice kernels;
+
+        static constexpr std::size_t STRIDE = sizeof(row_t) / sizeof(float_t);
+
+        // Looped variant kernels.batch in place of the unrolled batch loop.
+        template <typename V>
+        void batch_kernel(V const inputs[], outputs_t outs[], std::size_t n) const
+        {
+            detail::gemm_table<float_t, V, outputs_t>[kernels.batch](weights.begin()->begin(), STRIDE, OUTPUTS, INPUTS + 1, inputs, outs, n);
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                for (int i = 0; i < OUTPUTS; ++i)
+                {
+                    outs[b][i] = 1 / (1 + ((float_t)(exp(-outs[b][i]))));
+                }
+            }
+        }
 
     public:
         static constexpr std::size_t size() { return OUTPUTS; }
+        static constexpr std::size_t inputs() { return INPUTS; }
         auto const &get_weights() const { return weights; }
+        auto &get_weights() { return weights; }
         auto const &get_outputs() const { return outputs; }
         auto const &get_deltas() const { return deltas; }
+        kernel_choice get_kernels() const { return kernels; }
+        void set_kernels(kernel_choice choice) { kernels = choice; }
 
         Layer()
         {
@@ -194,33 +711,109 @@ namespace meta_ai
         void feed(L const &prev_layer)
         {
             auto const &inputs = prev_layer.get_outputs();
+            if (kernels.feed)
+            {
+                detail::gemv_table<float_t>[kernels.feed](weights.begin()->begin(), STRIDE, OUTPUTS, INPUTS + 1, inputs.begin(), outputs.begin());
+            }
             for (int i = 0; i < OUTPUTS; ++i)
             {
-                outputs[i] = simd::sum(inputs * weights[i], float_t{0});
+                if (!kernels.feed)
+                {
+                    outputs[i] = simd::sum(simd::lazy(inputs) * weights[i], float_t{0});
+                }
                 outputs[i] = 1 / (1 + ((float_t)(exp(-outputs[i]))));
             }
         }
 
+        template <typename V>
+        void feed_batch(V const inputs[], outputs_t outs[], std::size_t n) const
+        {
+            if (kernels.batch)
+            {
+                batch_kernel(inputs, outs, n);
+                return;
+            }
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                auto const &neuron_weights = weights[i];
+                for (std::size_t b = 0; b < n; ++b)
+                {
+                    float_t const sum = simd::sum(simd::lazy(inputs[b]) * neuron_weights, float_t{0});
+                    outs[b][i] = 1 / (1 + ((float_t)(exp(-sum))));
+                }
+            }
+        }
+
+        template <typename L>
+        void compute_deltas(L const &next_layer)
+        {
+            auto const &answers = next_layer.get_outputs();
+
+            deltas = (answers - outputs) * (outputs * (simd::scalar<decltype(outputs)>(1) - outputs));
+        }
+
         template <typename L1, typename L2>
         void tune(L1 const &prev_layer, L2 const &next_layer, float_t rate)
         {
             auto const &inputs = prev_layer.get_outputs();
-            auto const &answers = next_layer.get_outputs();
 
-            deltas = (answers - outputs) * (outputs * (simd::scalar<decltype(outputs)>(1) - outputs));
+            compute_deltas(next_layer);
             auto const delta_rate = simd::scalar<decltype(deltas)>(rate) * deltas;
 
             for (int i = 0; i < OUTPUTS; ++i)
             {
-                weights[i] = weights[i] + inputs * simd::scalar<typename std::remove_const<typename std::remove_reference<decltype(inputs)>::type>::type>(delta_rate[i]);
+                simd::assign(weights[i], simd::lazy(weights[i]) + inputs * simd::broadcast<row_t>(delta_rate[i]));
+            }
+        }
+
+        // Sparse input: only the nnz (index, value) pairs are non-zero. The cost is
+        // OUTPUTS * nnz instead of OUTPUTS * INPUTS, and only those columns are updated.
+        void feed_sparse(uint32_t const index[], float_t const value[], std::size_t nnz)
+        {
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                float_t const *neuron_weights = weights.begin()[i].begin();
+                float_t sum = neuron_weights[INPUTS];
+                for (std::size_t k = 0; k < nnz; ++k)
+                {
+                    sum += neuron_weights[index[k]] * value[k];
+                }
+                outputs[i] = 1 / (1 + ((float_t)(exp(-sum))));
             }
         }
+
+        template <typename L>
+        void tune_sparse(uint32_t const index[], float_t const value[], std::size_t nnz, L const &next_layer, float_t rate)
+        {
+            compute_deltas(next_layer);
+
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                float_t const delta_rate = rate * deltas[i];
+                float_t *neuron_weights = weights.begin()[i].begin();
+                for (std::size_t k = 0; k < nnz; ++k)
+                {
+                    neuron_weights[index[k]] += value[k] * delta_rate;
+                }
+                neuron_weights[INPUTS] += delta_rate;
+            }
+        }
+
+        // Mini-batch training without the layer's own activations: see detail::backward_rows.
+        // The gradient is a zero-initialized gradient_t (new gradient_t()) owned by the caller.
+        template <typename V>
+        void backward_batch(V const inputs[], outputs_t const outs[], outputs_t errs[], gradient_t &grad, V back[], std::size_t n) const
+        {
+            detail::backward_rows<INPUTS, OUTPUTS>(weights, inputs, outs, errs, grad, back, n);
+        }
+
+        void apply_gradient(gradient_t &grad, float_t rate) { detail::apply_rows<INPUTS, OUTPUTS>(weights, grad, rate); }
     };
 
     template <typename float_t, std::size_t OUTPUTS>
     class Layer<float_t, OUTPUT<OUTPUTS>>
     {
-        simd::vector<float_t, OUTPUTS> outputs;
+        activations_t<float_t, OUTPUTS> outputs;
 
     public:
         void load(float_t const answer[])
@@ -236,13 +829,261 @@ namespace meta_ai
         }
     };
 
+    // Perceptron layer for widths at or above WIDE_LAYER_THRESHOLD. It has the same
+    // interface and arithmetic as the unrolled Layer specializations, but the weights
+    // (and wide activations) live on the heap and every kernel is a plain loop, so compile
+    // time and object size do not grow with the width. LAST selects the output-layer form.
+    template <typename float_t, std::size_t INPUTS, std::size_t OUTPUTS, bool LAST>
+    class WideLayer
+    {
+    public:
+        using outputs_t = activations_t<float_t, OUTPUTS, LAST ? 0 : 1>;
+        using gradient_t = wide_matrix<float_t, OUTPUTS, INPUTS + 1>;
+
+    private:
+        using weights_t = wide_matrix<float_t, OUTPUTS, INPUTS + 1>;
+
+        weights_t weights;
+        outputs_t outputs;
+        outputs_t deltas;
+        kernel_choice kernels;
+        parallel_executor *executor = nullptr;
+
+        // Neurons per chunk when feed and tune are split across threads: a whole number of
+        // kernel row blocks, and of cache lines of outputs.
+        static constexpr std::size_t ROW_GRAIN = 16;
+
+        static float_t sigmoid(float_t x) { return 1 / (1 + ((float_t)(exp(-x)))); }
+
+        parallel_executor *split_executor() const
+        {
+            return OUTPUTS * (INPUTS + 1) >= INTRA_OP_MIN_MACS ? executor : nullptr;
+        }
+
+    public:
+        static constexpr std::size_t size() { return OUTPUTS; }
+        static constexpr std::size_t inputs() { return INPUTS; }
+        auto const &get_weights() const { return weights; }
+        auto &get_weights() { return weights; }
+        auto const &get_outputs() const { return outputs; }
+        auto const &get_deltas() const { return deltas; }
+        kernel_choice get_kernels() const { return kernels; }
+        void set_kernels(kernel_choice choice) { kernels = choice; }
+
+        // Splits feed and tune by neuron across executor's threads (nullptr: single-threaded).
+        // Layers under INTRA_OP_MIN_MACS ignore it.
+        void set_executor(parallel_executor *e) { executor = e; }
+        parallel_executor *get_executor() const { return executor; }
+
+        WideLayer()
+        {
+            for (auto &&neuron_weights : weights)
+            {
+                for (auto &weight : neuron_weights)
+                {
+                    weight = ((float_t)fast_rand()) / ((float_t)FAST_RAND_MAX);
+                }
+            }
+            for (auto &output : outputs)
+            {
+                output = 0;
+            }
+            if constexpr (!LAST)
+            {
+                outputs[OUTPUTS] = 1;
+            }
+        }
+
+        // Sets the outputs as if feed had computed them (see Layer::load).
+        void load(float_t const values[])
+        {
+            std::copy(values, values + OUTPUTS, outputs.begin());
+        }
+
+        template <typename L>
+        void feed(L const &prev_layer)
+        {
+            float_t const *x = prev_layer.get_outputs().begin();
+            detail::parallel_for(split_executor(), OUTPUTS, ROW_GRAIN, [&](std::size_t begin, std::size_t end)
+                                 {
+                                     float_t const *w = weights.data() + begin * weights_t::STRIDE;
+                                     float_t *out = outputs.begin();
+                                     if (kernels.feed)
+                                     {
+                                         detail::gemv_table<float_t>[kernels.feed](w, weights_t::STRIDE, end - begin, INPUTS + 1, x, out + begin);
+                                     }
+                                     else
+                                     {
+                                         detail::wide_gemv<4, WIDE_TILE>(w, weights_t::STRIDE, end - begin, INPUTS + 1, x, out + begin);
+                                     }
+                                     for (std::size_t i = begin; i < end; ++i)
+                                     {
+                                         out[i] = sigmoid(out[i]);
+                                     } });
+        }
+
+        template <typename V>
+        void feed_batch(V const inputs[], outputs_t outs[], std::size_t n) const
+        {
+            if (kernels.batch)
+            {
+                detail::gemm_table<float_t, V, outputs_t>[kernels.batch](weights.data(), weights_t::STRIDE, OUTPUTS, INPUTS + 1, inputs, outs, n);
+            }
+            else
+            {
+                detail::wide_gemm<4, WIDE_TILE>(weights.data(), weights_t::STRIDE, OUTPUTS, INPUTS + 1, inputs, outs, n);
+            }
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                for (std::size_t i = 0; i < OUTPUTS; ++i)
+                {
+                    outs[b][i] = sigmoid(outs[b][i]);
+                }
+                if constexpr (!LAST)
+                {
+                    outs[b][OUTPUTS] = 1;
+                }
+            }
+        }
+
+        // Deltas of neurons [begin, end). Each depends only on the next layer, so disjoint
+        // ranges can be computed concurrently.
+        template <typename L>
+        void compute_deltas(L const &next_layer, std::size_t begin, std::size_t end)
+        {
+            float_t *d = deltas.begin();
+            float_t const *out = outputs.begin();
+
+            if constexpr (LAST)
+            {
+                float_t const *answers = next_layer.get_outputs().begin();
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    d[i] = answers[i] - out[i];
+                }
+            }
+            else
+            {
+                // deltas = next_weights^T * next_deltas, accumulated one next-layer row at a
+                // time over a WIDE_TILE slice of deltas so the slice stays in L1.
+                auto const &next_weights = next_layer.get_weights();
+                auto const &next_deltas = next_layer.get_deltas();
+                std::fill(d + begin, d + end, float_t{0});
+                for (std::size_t i0 = begin; i0 < end; i0 += WIDE_TILE)
+                {
+                    std::size_t const i1 = std::min<std::size_t>(end, i0 + WIDE_TILE);
+                    for (std::size_t j = 0; j < next_layer.size(); ++j)
+                    {
+                        float_t const *row = next_weights.begin()[j].begin();
+                        float_t const nd = next_deltas[j];
+                        for (std::size_t i = i0; i < i1; ++i)
+                        {
+                            d[i] += nd * row[i];
+                        }
+                    }
+                }
+            }
+
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                d[i] *= out[i] * (1 - out[i]);
+            }
+        }
+
+        template <typename L>
+        void compute_deltas(L const &next_layer) { compute_deltas(next_layer, 0, OUTPUTS); }
+
+        // Deltas and the update of a neuron's row only touch that neuron, so when split, each
+        // thread does both for its own range and the layer needs a single barrier.
+        template <typename L1, typename L2>
+        void tune(L1 const &prev_layer, L2 const &next_layer, float_t rate)
+        {
+            float_t const *x = prev_layer.get_outputs().begin();
+            detail::parallel_for(split_executor(), OUTPUTS, ROW_GRAIN, [&](std::size_t begin, std::size_t end)
+                                 {
+                                     compute_deltas(next_layer, begin, end);
+                                     for (std::size_t k0 = 0; k0 < INPUTS + 1; k0 += WIDE_TILE)
+                                     {
+                                         std::size_t const k1 = std::min<std::size_t>(INPUTS + 1, k0 + WIDE_TILE);
+                                         for (std::size_t i = begin; i < end; ++i)
+                                         {
+                                             float_t *row = weights[i].begin();
+                                             float_t const delta_rate = rate * deltas[i];
+                                             for (std::size_t k = k0; k < k1; ++k)
+                                             {
+                                                 row[k] += x[k] * delta_rate;
+                                             }
+                                         }
+                                     } });
+        }
+
+        void feed_sparse(uint32_t const index[], float_t const value[], std::size_t nnz)
+        {
+            for (std::size_t i = 0; i < OUTPUTS; ++i)
+            {
+                float_t const *neuron_weights = weights[i].begin();
+                float_t sum = neuron_weights[INPUTS];
+                for (std::size_t k = 0; k < nnz; ++k)
+                {
+                    sum += neuron_weights[index[k]] * value[k];
+                }
+                outputs[i] = sigmoid(sum);
+            }
+        }
+
+        template <typename L>
+        void tune_sparse(uint32_t const index[], float_t const value[], std::size_t nnz, L const &next_layer, float_t rate)
+        {
+            compute_deltas(next_layer);
+
+            for (std::size_t i = 0; i < OUTPUTS; ++i)
+            {
+                float_t const delta_rate = rate * deltas[i];
+                float_t *neuron_weights = weights[i].begin();
+                for (std::size_t k = 0; k < nnz; ++k)
+                {
+                    neuron_weights[index[k]] += value[k] * delta_rate;
+                }
+                neuron_weights[INPUTS] += delta_rate;
+            }
+        }
+
+        // Mini-batch training without the layer's own activations: see detail::backward_rows.
+        // The gradient is a zero-initialized gradient_t (new gradient_t()) owned by the caller.
+        template <typename V>
+        void backward_batch(V const inputs[], outputs_t const outs[], outputs_t errs[], gradient_t &grad, V back[], std::size_t n) const
+        {
+            detail::backward_rows<INPUTS, OUTPUTS>(weights, inputs, outs, errs, grad, back, n);
+        }
+
+        void apply_gradient(gradient_t &grad, float_t rate) { detail::apply_rows<INPUTS, OUTPUTS>(weights, grad, rate); }
+    };
+
+    template <std::size_t INPUTS, std::size_t OUTPUTS>
+    constexpr bool is_wide_layer() { return INPUTS >= WIDE_LAYER_THRESHOLD || OUTPUTS >= WIDE_LAYER_THRESHOLD; }
+
+    template <typename float_t, typename A, typename B>
+    struct PerceptronLayer;
+
+    template <typename float_t, std::size_t INPUTS, std::size_t OUTPUTS>
+    struct PerceptronLayer<float_t, HIDDEN<INPUTS>, HIDDEN<OUTPUTS>>
+    {
+        using type = std::conditional_t<is_wide_layer<INPUTS, OUTPUTS>(), WideLayer<float_t, INPUTS, OUTPUTS, false>, Layer<float_t, HIDDEN<INPUTS>, HIDDEN<OUTPUTS>>>;
+    };
+
+    template <typename float_t, std::size_t INPUTS, std::size_t OUTPUTS>
+    struct PerceptronLayer<float_t, HIDDEN<INPUTS>, OUTPUT<OUTPUTS>>
+    {
+        using type = std::conditional_t<is_wide_layer<INPUTS, OUTPUTS>(), WideLayer<float_t, INPUTS, OUTPUTS, true>, Layer<float_t, HIDDEN<INPUTS>, OUTPUT<OUTPUTS>>>;
+    };
+
     template <typename float_t, typename A, typename B>
     struct MakePerceptronLayers;
 
     template <typename float_t, typename... As, typename... Bs>
     struct MakePerceptronLayers<float_t, META_ARR<As...>, META_ARR<Bs...>>
     {
-        using PerceptronLayers = std::tuple<Layer<float_t, As, Bs>...>;
+        using PerceptronLayers = std::tuple<typename PerceptronLayer<float_t, As, Bs>::type...>;
     };
 
     template <typename A, typename B, typename C>
@@ -280,6 +1121,64 @@ namespace meta_ai
             // 0 1 2 3
         }
 
+        template <std::size_t... I>
+        void forward_batch(float_t const input[], std::size_t n, float_t output[], std::index_sequence<I...>) const
+        {
+            // Per thread rather than per model, since concurrent callers may share the model;
+            // wide activations are then allocated once per thread, not on every call.
+            static thread_local decltype(make_batch_activations(std::make_index_sequence<N_LAYERS - 2>{})) activations;
+
+            auto &loaded = std::get<INPUT_LAYER>(activations);
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                for (std::size_t k = 0; k < INPUTS; ++k)
+                {
+                    loaded[b][k] = input[b * INPUTS + k];
+                }
+                loaded[b][INPUTS] = 1;
+            }
+
+            ((std::get<I + 1>(layers).feed_batch(std::get<I>(activations).data(), std::get<I + 1>(activations).data(), n)), ...);
+
+            auto const &predictions = std::get<OUTPUT_LAYER>(activations);
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                for (std::size_t k = 0; k < OUTPUTS; ++k)
+                {
+                    output[b * OUTPUTS + k] = predictions[b][k];
+                }
+            }
+        }
+
+        // Sparse-input passes: the first perceptron layer reads the (index, value) pairs
+        // directly, the layers after it run as usual.
+        template <std::size_t... I>
+        void forward_sparse(uint32_t const index[], float_t const value[], std::size_t nnz, std::index_sequence<I...>)
+        {
+            std::get<INPUT_LAYER + 1>(layers).feed_sparse(index, value, nnz);
+            ((std::get<I + 2>(layers).feed(std::get<I + 1>(layers))), ...);
+        }
+
+        template <std::size_t... I>
+        void backprog_sparse(uint32_t const index[], float_t const value[], std::size_t nnz, float_t const answer[], float_t rate, std::index_sequence<I...>)
+        {
+            std::get<ANSWER_LAYER>(layers).load(answer);
+            ((std::get<I + 2>(layers).tune(std::get<I + 1>(layers), std::get<I + 3>(layers), rate)), ...);
+            std::get<INPUT_LAYER + 1>(layers).tune_sparse(index, value, nnz, std::get<INPUT_LAYER + 2>(layers), rate);
+        }
+
+        template <typename F, std::size_t... I>
+        void visit(F &&func, std::index_sequence<I...>)
+        {
+            ((func(std::get<I + 1>(layers))), ...);
+        }
+
+        template <typename F, std::size_t... I>
+        void visit(F &&func, std::index_sequence<I...>) const
+        {
+            ((func(std::get<I + 1>(layers))), ...);
+        }
+
         template <std::size_t... I>
         void backprog(float_t const answer[], float_t rate, std::index_sequence<I...>)
         {
@@ -288,16 +1187,119 @@ namespace meta_ai
         }
 
     public:
-        void train(float_t const input[], float_t const answer[], float_t rate)
+        using value_type = float_t;
+
+        static constexpr std::size_t BATCH = 16;
+
+    private:
+        template <std::size_t... I>
+        static auto make_batch_activations(std::index_sequence<I...>) -> std::tuple<std::array<typename std::tuple_element_t<I, Layers>::outputs_t, BATCH>..., std::array<typename std::tuple_element_t<OUTPUT_LAYER, Layers>::outputs_t, BATCH>>;
+
+    public:
+        static constexpr std::size_t inputs() { return INPUTS; }
+        static constexpr std::size_t outputs() { return OUTPUTS; }
+
+        // Layer widths from input to output, e.g. {4, 7, 3, 3}.
+        static constexpr std::array<std::size_t, sizeof...(HIDDENS) + 2> topology() { return {INPUTS, HIDDENS..., OUTPUTS}; }
+
+        // Redraws every weight uniformly from [-1, 1] / sqrt(INPUTS + 1) of its layer. The default
+        // [0, 1] initialization saturates the sigmoids of wide layers; this one keeps them trainable.
+        void xavier_init() { xavier_init(g_seed); }
+
+        // The same from fast_rand(seed), which advances seed instead of the global stream.
+        void xavier_init(unsigned int &seed)
+        {
+            for_each_layer([&](auto &layer)
+                           {
+                               float_t const scale = 1 / sqrt((float_t)(layer.inputs() + 1));
+                               for (auto &&neuron_weights : layer.get_weights())
+                               {
+                                   for (auto &weight : neuron_weights)
+                                   {
+                                       weight = scale * (2 * ((float_t)fast_rand(seed)) / ((float_t)FAST_RAND_MAX) - 1);
+                                   }
+                               } });
+        }
+
+        // Redraws every weight from the constructor's distribution, uniform over [0, 1], but
+        // from fast_rand(seed).
+        void uniform_init(unsigned int &seed)
+        {
+            for_each_layer([&](auto &layer)
+                           {
+                               for (auto &&neuron_weights : layer.get_weights())
+                               {
+                                   for (auto &weight : neuron_weights)
+                                   {
+                                       weight = ((float_t)fast_rand(seed)) / ((float_t)FAST_RAND_MAX);
+                                   }
+                               } });
+        }
+
+        // Perceptron layers by index, 0 being the first hidden layer, for code that drives the
+        // layers itself (e.g. PipelineTrainer, pipeline.hpp).
+        static constexpr std::size_t depth() { return N_LAYERS - 2; }
+
+        template <std::size_t L>
+        using layer_type = std::tuple_element_t<L + 1, Layers>;
+
+        template <std::size_t L>
+        layer_type<L> &layer() { return std::get<L + 1>(layers); }
+
+        template <std::size_t L>
+        layer_type<L> const &layer() const { return std::get<L + 1>(layers); }
+
+        // Calls func on every perceptron layer, from the first hidden layer to the output layer.
+        template <typename F>
+        void for_each_layer(F &&func) { visit(func, std::make_index_sequence<N_LAYERS - 2>{}); }
+
+        template <typename F>
+        void for_each_layer(F &&func) const { visit(func, std::make_index_sequence<N_LAYERS - 2>{}); }
+
+        // Returns the sample's squared error, summed over the outputs, as predicted by the
+        // forward pass before the update.
+        float_t train(float_t const input[], float_t const answer[], float_t rate)
         {
             forward(input, std::make_index_sequence<N_LAYERS - 2>{});
+            auto const &prediction = std::get<OUTPUT_LAYER>(layers).get_outputs();
+            float_t loss = 0;
+            for (std::size_t k = 0; k < OUTPUTS; ++k)
+            {
+                float_t const error = answer[k] - prediction[k];
+                loss += error * error;
+            }
             backprog(answer, rate, makeIndexSequenceReverse<N_LAYERS - 2>{});
+            return loss;
         }
         auto const &predict(float_t const input[])
         {
             forward(input, std::make_index_sequence<N_LAYERS - 2>{});
             return std::get<OUTPUT_LAYER>(layers).get_outputs();
         }
+
+        // Training and inference on sparse inputs given as nnz (index, value) pairs, e.g.
+        // one-hot or multi-hot categorical features. Indices must be below INPUTS.
+        void train_sparse(uint32_t const index[], float_t const value[], std::size_t nnz, float_t const answer[], float_t rate)
+        {
+            forward_sparse(index, value, nnz, std::make_index_sequence<N_LAYERS - 3>{});
+            backprog_sparse(index, value, nnz, answer, rate, makeIndexSequenceReverse<N_LAYERS - 3>{});
+        }
+        auto const &predict_sparse(uint32_t const index[], float_t const value[], std::size_t nnz)
+        {
+            forward_sparse(index, value, nnz, std::make_index_sequence<N_LAYERS - 3>{});
+            return std::get<OUTPUT_LAYER>(layers).get_outputs();
+        }
+
+        // Batched inference: n row-major samples in, n row-major predictions out.
+        // Does not touch the layers' own outputs, so concurrent callers may share the model.
+        void predict_batch(float_t const input[], std::size_t n, float_t output[]) const
+        {
+            for (std::size_t b = 0; b < n; b += BATCH)
+            {
+                std::size_t const count = n - b < BATCH ? n - b : BATCH;
+                forward_batch(input + b * INPUTS, count, output + b * OUTPUTS, std::make_index_sequence<N_LAYERS - 2>{});
+            }
+        }
     };
 };
 
@@ -0,0 +1,177 @@
+#ifndef __MODEL_HANDLE_H__
+#define __MODEL_HANDLE_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// RCU-style handle for live model replacement.
+//
+// Readers pin the current model with two atomic operations (announce the global epoch,
+// load the pointer) and no lock, loop or allocation, so the read path is wait-free.
+// A writer publishes a fully built model with one atomic exchange; the model it
+// replaces is retired and deleted once every reader that could still see it has
+// unpinned (epoch-based reclamation).
+//
+// Pinned models are const: serve them with MLP::predict_batch, which leaves the model
+// untouched, not with predict/train.
+
+namespace meta_ai
+{
+    template <typename Model, std::size_t MAX_READERS = 64>
+    class ModelHandle
+    {
+        struct alignas(64) reader_slot
+        {
+            // 0 when the reader holds nothing, otherwise the epoch it observed when pinning.
+            std::atomic<uint64_t> epoch{0};
+            std::atomic<bool> claimed{false};
+        };
+
+        struct retired_model
+        {
+            Model const *model;
+            uint64_t epoch;
+        };
+
+        std::atomic<Model const *> current;
+        std::atomic<uint64_t> epoch{1};
+        reader_slot slots[MAX_READERS];
+
+        std::mutex writer_lock;
+        std::vector<retired_model> retired;
+        std::atomic<unsigned long> reclaimed{0};
+
+        // Deletes every retired model that no pinned reader can still reference.
+        void collect()
+        {
+            uint64_t oldest = UINT64_MAX;
+            for (auto &slot : slots)
+            {
+                uint64_t const e = slot.epoch.load(std::memory_order_seq_cst);
+                if (e != 0 && e < oldest)
+                    oldest = e;
+            }
+
+            std::size_t kept = 0;
+            for (auto const &r : retired)
+            {
+                // A reader that announced epoch e > r.epoch loaded the pointer after it was replaced.
+                if (r.epoch < oldest)
+                {
+                    delete r.model;
+                    ++reclaimed;
+                }
+                else
+                {
+                    retired[kept++] = r;
+                }
+            }
+            retired.resize(kept);
+        }
+
+    public:
+        class pinned
+        {
+            reader_slot *slot;
+            Model const *model;
+
+        public:
+            pinned(reader_slot *slot, Model const *model) : slot(slot), model(model) {}
+            pinned(pinned const &) = delete;
+            pinned &operator=(pinned const &) = delete;
+            ~pinned() { slot->epoch.store(0, std::memory_order_release); }
+
+            Model const *operator->() const { return model; }
+            Model const &operator*() const { return *model; }
+        };
+
+        // A reader owns one slot for its lifetime; create one per thread.
+        class reader
+        {
+            ModelHandle *handle;
+            reader_slot *slot = nullptr;
+
+        public:
+            explicit reader(ModelHandle &handle) : handle(&handle)
+            {
+                for (auto &s : handle.slots)
+                {
+                    bool expected = false;
+                    if (s.claimed.compare_exchange_strong(expected, true))
+                    {
+                        slot = &s;
+                        return;
+                    }
+                }
+            }
+            reader(reader const &) = delete;
+            reader &operator=(reader const &) = delete;
+            ~reader()
+            {
+                if (slot)
+                    slot->claimed.store(false, std::memory_order_release);
+            }
+
+            // False if all MAX_READERS slots were taken when the reader was created.
+            bool valid() const { return slot != nullptr; }
+
+            // One pin at a time per reader.
+            pinned pin()
+            {
+                slot->epoch.store(handle->epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+                return pinned(slot, handle->current.load(std::memory_order_seq_cst));
+            }
+        };
+
+        explicit ModelHandle(std::unique_ptr<Model> initial) : current(initial.release()) {}
+        ModelHandle(ModelHandle const &) = delete;
+        ModelHandle &operator=(ModelHandle const &) = delete;
+
+        // Readers must be gone by now.
+        ~ModelHandle()
+        {
+            for (auto const &r : retired)
+                delete r.model;
+            delete current.load();
+        }
+
+        // Makes next visible to every later pin and retires the previous model.
+        void publish(std::unique_ptr<Model> next)
+        {
+            std::lock_guard<std::mutex> lk(writer_lock);
+            Model const *previous = current.exchange(next.release(), std::memory_order_seq_cst);
+            uint64_t const e = epoch.fetch_add(1, std::memory_order_seq_cst);
+            retired.push_back({previous, e});
+            collect();
+        }
+
+        // Retries reclamation of models that were still pinned at their publish.
+        void reclaim()
+        {
+            std::lock_guard<std::mutex> lk(writer_lock);
+            collect();
+        }
+
+        // A private copy of the current model, e.g. to train the next version from. Needs no
+        // reader slot: the current model is only replaced and reclaimed under writer_lock.
+        std::unique_ptr<Model> clone()
+        {
+            std::lock_guard<std::mutex> lk(writer_lock);
+            return std::unique_ptr<Model>(new Model(*current.load(std::memory_order_acquire)));
+        }
+
+        std::size_t pending_reclaim()
+        {
+            std::lock_guard<std::mutex> lk(writer_lock);
+            return retired.size();
+        }
+
+        unsigned long reclaimed_models() const { return reclaimed; }
+    };
+};
+
+#endif
@@ -0,0 +1,362 @@
+#ifndef __MULTI_MLP_H__
+#define __MULTI_MLP_H__
+
+#include "mlp.hpp"
+
+// Model-batched MLP: MODELS networks with the same topology trained side by side.
+// Every scalar of the plain MLP becomes a vector of MODELS lanes, so lane k of every
+// register belongs to model k and one pass over the data trains the whole sweep.
+
+namespace meta_ai
+{
+    template <typename float_t, std::size_t MODELS>
+    using lanes = simd::vector<float_t, MODELS, (MODELS * sizeof(float_t) >= 64 ? 64 : 32)>;
+
+    template <std::size_t MODELS>
+    using lane_seeds = simd::vector<unsigned int, MODELS>;
+
+    // A plain loop over the lanes lets the compiler use its vector exp.
+    template <typename V>
+    inline V lane_sigmoid(V const &xs)
+    {
+        V r;
+        for (std::size_t m = 0; m < V::size(); ++m)
+        {
+            r[m] = 1 / (1 + ((typename V::value_type)(exp(-xs[m]))));
+        }
+        return r;
+    }
+
+    // acc += a * b, lane by lane. Kept as plain loops over references so that no
+    // temporaries of the (large) lane vectors are materialized in the hot path.
+    template <typename V>
+    inline void lane_fma(V &acc, V const &a, V const &b)
+    {
+        for (std::size_t m = 0; m < V::size(); ++m)
+        {
+            acc[m] += a.data[m] * b.data[m];
+        }
+    }
+
+    template <typename float_t, std::size_t MODELS>
+    inline lanes<float_t, MODELS> lane_rand(lane_seeds<MODELS> &seeds)
+    {
+        lanes<float_t, MODELS> r;
+        for (std::size_t m = 0; m < MODELS; ++m)
+        {
+            seeds[m] = (214013 * seeds[m] + 2531011);
+            r[m] = ((float_t)((seeds[m] >> 16) & 0x7FFF)) / ((float_t)FAST_RAND_MAX);
+        }
+        return r;
+    }
+
+    template <typename float_t, std::size_t MODELS, typename... Ts>
+    class MultiLayer;
+
+    template <typename float_t, std::size_t MODELS, std::size_t OUTPUTS>
+    class MultiLayer<float_t, MODELS, INPUT<OUTPUTS>>
+    {
+        using lane_t = lanes<float_t, MODELS>;
+        simd::vector<lane_t, OUTPUTS + 1> outputs;
+
+    public:
+        MultiLayer()
+        {
+            for (auto &output : outputs)
+            {
+                output = simd::scalar<lane_t>(float_t{0});
+            }
+            outputs[OUTPUTS] = simd::scalar<lane_t>(float_t{1});
+        }
+        void load(float_t const input[])
+        {
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                outputs[i] = simd::scalar<lane_t>(input[i]);
+            }
+        }
+        auto const &get_outputs() const
+        {
+            return outputs;
+        }
+    };
+
+    template <typename float_t, std::size_t MODELS, std::size_t INPUTS, std::size_t OUTPUTS>
+    class MultiLayer<float_t, MODELS, HIDDEN<INPUTS>, HIDDEN<OUTPUTS>>
+    {
+        using lane_t = lanes<float_t, MODELS>;
+        simd::vector<simd::vector<lane_t, INPUTS + 1>, OUTPUTS> weights;
+        simd::vector<lane_t, OUTPUTS + 1> outputs;
+        simd::vector<lane_t, OUTPUTS + 1> deltas;
+
+    public:
+        static constexpr std::size_t size() { return OUTPUTS; }
+        auto const &get_weights() const { return weights; }
+        auto const &get_outputs() const { return outputs; }
+        auto const &get_deltas() const { return deltas; }
+
+        MultiLayer()
+        {
+            for (auto &output : outputs)
+            {
+                output = simd::scalar<lane_t>(float_t{0});
+            }
+            outputs[OUTPUTS] = simd::scalar<lane_t>(float_t{1});
+        }
+
+        void randomize(lane_seeds<MODELS> &seeds)
+        {
+            for (auto &neuron_weights : weights)
+            {
+                for (auto &weight : neuron_weights)
+                {
+                    weight = lane_rand<float_t, MODELS>(seeds);
+                }
+            }
+        }
+
+        template <typename L>
+        void feed(L const &prev_layer)
+        {
+            auto const &inputs = prev_layer.get_outputs();
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                auto sum = simd::scalar<lane_t>(float_t{0});
+                for (int j = 0; j < INPUTS + 1; ++j)
+                {
+                    lane_fma(sum, inputs.data[j], weights[i][j]);
+                }
+                outputs[i] = lane_sigmoid(sum);
+            }
+        }
+
+        template <typename L1, typename L2>
+        void tune(L1 const &prev_layer, L2 const &next_layer, lane_t const &rate)
+        {
+            auto constexpr next_size = next_layer.size();
+
+            auto const &next_weights = next_layer.get_weights();
+            auto const &next_deltas = next_layer.get_deltas();
+            auto const &inputs = prev_layer.get_outputs();
+
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                deltas[i] = simd::scalar<lane_t>(float_t{0});
+                for (int j = 0; j < next_size; ++j)
+                {
+                    lane_fma(deltas[i], next_deltas.data[j], next_weights.data[j].data[i]);
+                }
+                for (std::size_t m = 0; m < MODELS; ++m)
+                {
+                    deltas[i][m] *= outputs[i][m] * (1 - outputs[i][m]);
+                }
+            }
+
+            update(inputs, rate);
+        }
+
+    private:
+        template <typename V>
+        void update(V const &inputs, lane_t const &rate)
+        {
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                lane_t delta_rate;
+                for (std::size_t m = 0; m < MODELS; ++m)
+                {
+                    delta_rate[m] = rate.data[m] * deltas[i][m];
+                }
+                for (int j = 0; j < INPUTS + 1; ++j)
+                {
+                    lane_fma(weights[i][j], inputs.data[j], delta_rate);
+                }
+            }
+        }
+    };
+
+    template <typename float_t, std::size_t MODELS, std::size_t INPUTS, std::size_t OUTPUTS>
+    class MultiLayer<float_t, MODELS, HIDDEN<INPUTS>, OUTPUT<OUTPUTS>>
+    {
+        using lane_t = lanes<float_t, MODELS>;
+        simd::vector<simd::vector<lane_t, INPUTS + 1>, OUTPUTS> weights;
+        simd::vector<lane_t, OUTPUTS> outputs;
+        simd::vector<lane_t, OUTPUTS> deltas;
+
+    public:
+        static constexpr std::size_t size() { return OUTPUTS; }
+        auto const &get_weights() const { return weights; }
+        auto const &get_outputs() const { return outputs; }
+        auto const &get_deltas() const { return deltas; }
+
+        MultiLayer()
+        {
+            for (auto &output : outputs)
+            {
+                output = simd::scalar<lane_t>(float_t{0});
+            }
+        }
+
+        void randomize(lane_seeds<MODELS> &seeds)
+        {
+            for (auto &neuron_weights : weights)
+            {
+                for (auto &weight : neuron_weights)
+                {
+                    weight = lane_rand<float_t, MODELS>(seeds);
+                }
+            }
+        }
+
+        template <typename L>
+        void feed(L const &prev_layer)
+        {
+            auto const &inputs = prev_layer.get_outputs();
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                auto sum = simd::scalar<lane_t>(float_t{0});
+                for (int j = 0; j < INPUTS + 1; ++j)
+                {
+                    lane_fma(sum, inputs.data[j], weights[i][j]);
+                }
+                outputs[i] = lane_sigmoid(sum);
+            }
+        }
+
+        template <typename L1, typename L2>
+        void tune(L1 const &prev_layer, L2 const &next_layer, lane_t const &rate)
+        {
+            auto const &inputs = prev_layer.get_outputs();
+            auto const &answers = next_layer.get_outputs();
+
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                for (std::size_t m = 0; m < MODELS; ++m)
+                {
+                    deltas[i][m] = (answers.data[i].data[m] - outputs[i][m]) * (outputs[i][m] * (1 - outputs[i][m]));
+                }
+            }
+
+            update(inputs, rate);
+        }
+
+    private:
+        template <typename V>
+        void update(V const &inputs, lane_t const &rate)
+        {
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                lane_t delta_rate;
+                for (std::size_t m = 0; m < MODELS; ++m)
+                {
+                    delta_rate[m] = rate.data[m] * deltas[i][m];
+                }
+                for (int j = 0; j < INPUTS + 1; ++j)
+                {
+                    lane_fma(weights[i][j], inputs.data[j], delta_rate);
+                }
+            }
+        }
+    };
+
+    template <typename float_t, std::size_t MODELS, std::size_t OUTPUTS>
+    class MultiLayer<float_t, MODELS, OUTPUT<OUTPUTS>>
+    {
+        using lane_t = lanes<float_t, MODELS>;
+        simd::vector<lane_t, OUTPUTS> outputs;
+
+    public:
+        void load(float_t const answer[])
+        {
+            for (int i = 0; i < OUTPUTS; ++i)
+            {
+                outputs[i] = simd::scalar<lane_t>(answer[i]);
+            }
+        }
+        auto const &get_outputs() const
+        {
+            return outputs;
+        }
+    };
+
+    template <typename float_t, std::size_t MODELS, typename A, typename B>
+    struct MakeMultiPerceptronLayers;
+
+    template <typename float_t, std::size_t MODELS, typename... As, typename... Bs>
+    struct MakeMultiPerceptronLayers<float_t, MODELS, META_ARR<As...>, META_ARR<Bs...>>
+    {
+        using PerceptronLayers = std::tuple<MultiLayer<float_t, MODELS, As, Bs>...>;
+    };
+
+    template <typename float_t, std::size_t MODELS, typename A, typename B, typename C>
+    class alignas(64) MultiMLP;
+
+    template <typename float_t, std::size_t MODELS, std::size_t INPUTS, std::size_t... HIDDENS, std::size_t OUTPUTS>
+    class alignas(64) MultiMLP<float_t, MODELS, INPUT<INPUTS>, HIDDEN<HIDDENS...>, OUTPUT<OUTPUTS>>
+    {
+    public:
+        using lane_t = lanes<float_t, MODELS>;
+        using seed_t = lane_seeds<MODELS>;
+
+    private:
+        using InputLayer = MultiLayer<float_t, MODELS, INPUT<INPUTS>>;
+        using PerceptronLayers = typename MakeMultiPerceptronLayers<float_t, MODELS, META_ARR<HIDDEN<INPUTS>, HIDDEN<HIDDENS>...>, META_ARR<HIDDEN<HIDDENS>..., OUTPUT<OUTPUTS>>>::PerceptronLayers;
+        using AnswerLayer = MultiLayer<float_t, MODELS, OUTPUT<OUTPUTS>>;
+        using Layers = typename JoinLayers<InputLayer, PerceptronLayers, AnswerLayer>::Layers;
+
+        static constexpr std::size_t INPUT_LAYER = 0;
+        static constexpr std::size_t OUTPUT_LAYER = 1 + sizeof...(HIDDENS);
+        static constexpr std::size_t ANSWER_LAYER = 1 + sizeof...(HIDDENS) + 1;
+        static constexpr std::size_t N_LAYERS = 1 + sizeof...(HIDDENS) + 1 + 1;
+
+        Layers layers;
+
+        template <std::size_t... I>
+        void randomize(seed_t &seeds, std::index_sequence<I...>)
+        {
+            ((std::get<I + 1>(layers).randomize(seeds)), ...);
+        }
+
+        template <std::size_t... I>
+        void forward(float_t const input[], std::index_sequence<I...>)
+        {
+            std::get<INPUT_LAYER>(layers).load(input);
+            ((std::get<I + 1>(layers).feed(std::get<I>(layers))), ...);
+        }
+
+        template <std::size_t... I>
+        void backprog(float_t const answer[], lane_t const &rate, std::index_sequence<I...>)
+        {
+            std::get<ANSWER_LAYER>(layers).load(answer);
+            ((std::get<I + 1>(layers).tune(std::get<I>(layers), std::get<I + 2>(layers), rate)), ...);
+        }
+
+    public:
+        static constexpr std::size_t models() { return MODELS; }
+
+        // Model k draws its initial weights from its own fast_rand stream seeded with seeds[k].
+        explicit MultiMLP(seed_t seeds = simd::iota<seed_t, unsigned int>(5u, 1u))
+        {
+            reseed(seeds);
+        }
+
+        void reseed(seed_t seeds)
+        {
+            randomize(seeds, std::make_index_sequence<N_LAYERS - 2>{});
+        }
+
+        void train(float_t const input[], float_t const answer[], lane_t const &rate)
+        {
+            forward(input, std::make_index_sequence<N_LAYERS - 2>{});
+            backprog(answer, rate, makeIndexSequenceReverse<N_LAYERS - 2>{});
+        }
+
+        // prediction[i][k] is output i of model k.
+        auto const &predict(float_t const input[])
+        {
+            forward(input, std::make_index_sequence<N_LAYERS - 2>{});
+            return std::get<OUTPUT_LAYER>(layers).get_outputs();
+        }
+    };
+};
+
+#endif
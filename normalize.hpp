@@ -0,0 +1,133 @@
+#ifndef __NORMALIZE_H__
+#define __NORMALIZE_H__
+
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include "mlp.hpp"
+
+// Per-feature input scaling that costs nothing at inference.
+//
+// FeatureStats gathers count, mean, variance (Welford) and min/max of every feature in
+// one streaming pass; the per-sample update is a loop over features that the compiler
+// vectorizes. A Normalizer built from it maps x to (x - shift) * scale and is applied to
+// inputs while training. For export, fold_normalization rewrites the first perceptron
+// layer so that it takes raw inputs:
+//
+//     w'[i][k] = w[i][k] * scale[k]
+//     b'[i]    = b[i] - sum_k w[i][k] * scale[k] * shift[k]     (bias lane INPUTS)
+//
+// after which the folded model gives the same outputs on x as the original on the
+// normalized x, up to rounding.
+
+namespace meta_ai
+{
+    template <typename float_t, std::size_t N>
+    class FeatureStats
+    {
+        uint64_t n = 0;
+        double mean_[N] = {};
+        double m2[N] = {};
+        float_t min_[N];
+        float_t max_[N];
+
+    public:
+        FeatureStats()
+        {
+            std::fill(min_, min_ + N, (float_t)INFINITY);
+            std::fill(max_, max_ + N, (float_t)-INFINITY);
+        }
+
+        void add(float_t const x[])
+        {
+            ++n;
+            double const inv = 1.0 / n;
+            for (std::size_t k = 0; k < N; ++k)
+            {
+                double const d = x[k] - mean_[k];
+                mean_[k] += d * inv;
+                m2[k] += d * (x[k] - mean_[k]);
+                min_[k] = std::min(min_[k], x[k]);
+                max_[k] = std::max(max_[k], x[k]);
+            }
+        }
+
+        // n_rows samples of N features each, row-major.
+        void add_rows(float_t const x[], std::size_t n_rows)
+        {
+            for (std::size_t r = 0; r < n_rows; ++r)
+                add(x + r * N);
+        }
+
+        uint64_t count() const { return n; }
+        double mean(std::size_t k) const { return mean_[k]; }
+        double variance(std::size_t k) const { return n ? m2[k] / n : 0; }
+        double stddev(std::size_t k) const { return sqrt(variance(k)); }
+        float_t min(std::size_t k) const { return min_[k]; }
+        float_t max(std::size_t k) const { return max_[k]; }
+    };
+
+    enum class normalization
+    {
+        standard, // zero mean, unit variance
+        min_max,  // [0, 1] over the observed range
+    };
+
+    template <typename float_t, std::size_t N>
+    struct Normalizer
+    {
+        float_t shift[N];
+        float_t scale[N];
+
+        // Constant features (zero spread) are only shifted.
+        Normalizer(FeatureStats<float_t, N> const &stats, normalization kind = normalization::standard)
+        {
+            for (std::size_t k = 0; k < N; ++k)
+            {
+                double const spread = kind == normalization::standard ? stats.stddev(k) : (double)stats.max(k) - stats.min(k);
+                shift[k] = kind == normalization::standard ? (float_t)stats.mean(k) : stats.min(k);
+                scale[k] = spread > DBL_EPSILON ? (float_t)(1 / spread) : 1;
+            }
+        }
+
+        void apply(float_t const in[], float_t out[]) const
+        {
+            for (std::size_t k = 0; k < N; ++k)
+                out[k] = (in[k] - shift[k]) * scale[k];
+        }
+
+        void apply_rows(float_t const in[], float_t out[], std::size_t n_rows) const
+        {
+            for (std::size_t r = 0; r < n_rows; ++r)
+                apply(in + r * N, out + r * N);
+        }
+    };
+
+    // Rewrites the first perceptron layer of model to take raw inputs. Fold once: the
+    // model must not be used with the normalizer afterwards.
+    template <typename Model>
+    void fold_normalization(Model &model, Normalizer<typename Model::value_type, Model::inputs()> const &norm)
+    {
+        bool first = true;
+        model.for_each_layer([&](auto &layer)
+                             {
+                                 if (!first)
+                                     return;
+                                 first = false;
+                                 for (std::size_t i = 0; i < layer.size(); ++i)
+                                 {
+                                     auto *row = layer.get_weights().begin()[i].begin();
+                                     double bias = row[Model::inputs()];
+                                     for (std::size_t k = 0; k < Model::inputs(); ++k)
+                                     {
+                                         double const w = (double)row[k] * norm.scale[k];
+                                         bias -= w * norm.shift[k];
+                                         row[k] = (typename Model::value_type)w;
+                                     }
+                                     row[Model::inputs()] = (typename Model::value_type)bias;
+                                 } });
+    }
+};
+
+#endif
@@ -0,0 +1,226 @@
+#ifndef __NUMERICS_H__
+#define __NUMERICS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+#include <immintrin.h>
+#include "mlp.hpp"
+
+// Denormal control and numeric health checks for long training runs.
+//
+// Saturated sigmoids make outputs * (1 - outputs) tiny, and the deltas and weight updates
+// built from it drift into subnormal floats, which x86 handles in microcode at up to
+// 100 times the cost of a normal operation. DenormalScope sets FTZ (flush results to
+// zero) and DAZ (read subnormal inputs as zero) in the calling thread's MXCSR and
+// restores the previous value when it ends. MXCSR is per thread, so the scope also
+// publishes its mode: the workers of WorkStealingPool, IntraOpPool and PipelineTrainer
+// switch to it before their next job and back to their own setting once the scope is
+// gone. Note that -Ofast already sets FTZ/DAZ at startup; denormals::keep turns gradual
+// underflow back on, e.g. to measure what it costs.
+//
+// HealthMonitor counts subnormal, NaN and infinite values in the weights and deltas of
+// every layer. It reads the bit patterns, since -Ofast assumes no NaN or Inf and folds
+// isnan/isinf away, and checks only every `every`-th call, so it can stay in the loop.
+
+namespace meta_ai
+{
+    enum class denormals
+    {
+        inherit, // leave MXCSR as the thread has it
+        flush,   // FTZ and DAZ on
+        keep     // FTZ and DAZ off: IEEE gradual underflow
+    };
+
+    namespace detail
+    {
+        constexpr unsigned MXCSR_DAZ = 1u << 6;
+        constexpr unsigned MXCSR_FTZ = 1u << 15;
+
+        // Mode of the innermost live DenormalScope, for the pool workers to follow.
+        inline std::atomic<int> denormal_mode{(int)denormals::inherit};
+
+        inline unsigned with_denormals(unsigned csr, denormals mode)
+        {
+            switch (mode)
+            {
+            case denormals::flush:
+                return csr | MXCSR_DAZ | MXCSR_FTZ;
+            case denormals::keep:
+                return csr & ~(MXCSR_DAZ | MXCSR_FTZ);
+            default:
+                return csr;
+            }
+        }
+
+        // Called by pool worker threads (never by a thread that opened a scope) before each
+        // job: one relaxed load when nothing changed.
+        inline void follow_denormal_mode()
+        {
+            thread_local unsigned const base = _mm_getcsr();
+            thread_local int applied = (int)denormals::inherit;
+            int const mode = denormal_mode.load(std::memory_order_relaxed);
+            if (mode == applied)
+                return;
+            applied = mode;
+            _mm_setcsr(with_denormals(base, (denormals)mode));
+        }
+
+        enum class fp_class
+        {
+            normal,
+            subnormal,
+            nan,
+            inf
+        };
+
+        inline fp_class classify(float x)
+        {
+            uint32_t bits;
+            memcpy(&bits, &x, sizeof(bits));
+            uint32_t const exponent = bits & 0x7F800000u, mantissa = bits & 0x007FFFFFu;
+            if (exponent == 0x7F800000u)
+                return mantissa ? fp_class::nan : fp_class::inf;
+            return exponent == 0 && mantissa ? fp_class::subnormal : fp_class::normal;
+        }
+
+        inline fp_class classify(double x)
+        {
+            uint64_t bits;
+            memcpy(&bits, &x, sizeof(bits));
+            uint64_t const exponent = bits & 0x7FF0000000000000ull, mantissa = bits & 0x000FFFFFFFFFFFFFull;
+            if (exponent == 0x7FF0000000000000ull)
+                return mantissa ? fp_class::nan : fp_class::inf;
+            return exponent == 0 && mantissa ? fp_class::subnormal : fp_class::normal;
+        }
+    };
+
+    // Sets the calling thread's denormal mode for its lifetime and asks the pool workers to
+    // follow. Scopes nest, but must be opened and closed by one controlling thread.
+    class DenormalScope
+    {
+        unsigned const saved;
+        int const previous;
+
+    public:
+        explicit DenormalScope(denormals mode = denormals::flush)
+            : saved(_mm_getcsr()), previous(detail::denormal_mode.exchange((int)mode))
+        {
+            _mm_setcsr(detail::with_denormals(saved, mode));
+        }
+
+        ~DenormalScope()
+        {
+            detail::denormal_mode.store(previous);
+            _mm_setcsr(saved);
+        }
+
+        DenormalScope(DenormalScope const &) = delete;
+        DenormalScope &operator=(DenormalScope const &) = delete;
+    };
+
+    // Whether FTZ and DAZ are both on in the calling thread.
+    inline bool flushing_denormals()
+    {
+        unsigned const bits = detail::MXCSR_DAZ | detail::MXCSR_FTZ;
+        return (_mm_getcsr() & bits) == bits;
+    }
+
+    struct value_counts
+    {
+        unsigned long subnormal = 0, nan = 0, inf = 0;
+
+        template <typename T>
+        void add(T x)
+        {
+            switch (detail::classify(x))
+            {
+            case detail::fp_class::subnormal:
+                ++subnormal;
+                break;
+            case detail::fp_class::nan:
+                ++nan;
+                break;
+            case detail::fp_class::inf:
+                ++inf;
+                break;
+            default:
+                break;
+            }
+        }
+
+        bool clean() const { return !subnormal && !nan && !inf; }
+    };
+
+    // Totals over every check so far; deltas are those left by the last train() call.
+    struct layer_health
+    {
+        value_counts weights;
+        value_counts deltas;
+    };
+
+    template <typename Model>
+    class HealthMonitor
+    {
+        std::size_t const every;
+        std::size_t calls = 0;
+        std::size_t checks = 0;
+        std::vector<layer_health> layers;
+
+    public:
+        explicit HealthMonitor(std::size_t every = 1) : every(every ? every : 1), layers(Model::depth()) {}
+
+        // Counts into the per-layer totals on every `every`-th call; returns whether the
+        // model was checked this time.
+        bool observe(Model const &model)
+        {
+            if (calls++ % every)
+                return false;
+            ++checks;
+            std::size_t l = 0;
+            model.for_each_layer([&](auto const &layer)
+                                 {
+                                     layer_health &health = layers[l++];
+                                     for (std::size_t i = 0; i < layer.size(); ++i)
+                                     {
+                                         auto const *row = layer.get_weights().begin()[i].begin();
+                                         for (std::size_t j = 0; j <= layer.inputs(); ++j)
+                                             health.weights.add(row[j]);
+                                         health.deltas.add(layer.get_deltas()[i]);
+                                     } });
+            return true;
+        }
+
+        std::size_t checked() const { return checks; }
+        layer_health const &layer(std::size_t l) const { return layers[l]; }
+
+        bool clean() const
+        {
+            for (auto const &health : layers)
+                if (!health.weights.clean() || !health.deltas.clean())
+                    return false;
+            return true;
+        }
+
+        void reset()
+        {
+            calls = checks = 0;
+            layers.assign(layers.size(), layer_health{});
+        }
+
+        void print(FILE *out = stdout) const
+        {
+            fprintf(out, "numeric health over %zu checks\n", checks);
+            for (std::size_t l = 0; l < layers.size(); ++l)
+            {
+                auto const &w = layers[l].weights, &d = layers[l].deltas;
+                fprintf(out, "  layer %zu  weights: %lu subnormal, %lu nan, %lu inf  deltas: %lu subnormal, %lu nan, %lu inf\n",
+                        l, w.subnormal, w.nan, w.inf, d.subnormal, d.nan, d.inf);
+            }
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "mlp.hpp"
+#include "numerics.hpp"
+#include "streaming.hpp"
+
+// Pipeline-parallel mini-batch training.
+//
+// The perceptron layers of a model are cut into contiguous stages of about equal weight
+// count, each run by its own thread. A mini-batch is split into micro-batches that flow
+// forward stage by stage and, from the last stage, backward again; stages hand each
+// other micro-batch slots through lock-free SPSC queues, while the activations and errors
+// stay in per-slot buffers owned by the trainer. A stage always prefers backward work,
+// so the last stage runs one forward, one backward (1F1B) and in-flight activations stay
+// bounded by the pipeline depth.
+//
+// Each layer accumulates its gradient over the whole mini-batch, in micro-batch order,
+// and applies it once the last micro-batch has gone through its backward pass. Weights
+// are therefore fixed within a mini-batch: the update is the sum of the per-sample
+// updates MLP::train would make, all computed from the mini-batch's starting weights,
+// and the result does not depend on the number of stages.
+
+namespace meta_ai
+{
+    template <typename Model>
+    class PipelineTrainer
+    {
+    public:
+        using float_t = typename Model::value_type;
+        static constexpr std::size_t DEPTH = Model::depth();
+
+    private:
+        template <std::size_t L>
+        using layer_t = typename Model::template layer_type<L>;
+        using input_t = activations_t<float_t, Model::inputs(), 1>;
+
+        // Element 0 holds the loaded inputs, element L + 1 the outputs of layer L.
+        template <std::size_t... L>
+        static auto make_activations(std::index_sequence<L...>) -> std::tuple<std::vector<input_t>, std::vector<typename layer_t<L>::outputs_t>...>;
+        template <std::size_t... L>
+        static auto make_gradients(std::index_sequence<L...>) -> std::tuple<std::unique_ptr<typename layer_t<L>::gradient_t>...>;
+
+        using activations_tuple = decltype(make_activations(std::make_index_sequence<DEPTH>{}));
+        using gradients_tuple = decltype(make_gradients(std::make_index_sequence<DEPTH>{}));
+
+        static constexpr uint32_t STOP = UINT32_MAX;
+
+        struct slot
+        {
+            float_t const *input;
+            float_t const *answer;
+            std::size_t n;
+        };
+
+        struct stage
+        {
+            std::size_t first, last; // layers [first, last]
+            streaming::SpscQueue<uint32_t> forward, backward;
+            std::size_t done = 0; // micro-batches through backward in this mini-batch
+            std::thread thread;
+
+            stage(std::size_t first, std::size_t last, std::size_t capacity)
+                : first(first), last(last), forward(capacity), backward(capacity) {}
+        };
+
+        Model &model;
+        std::size_t const micro_batch, micro_batches;
+        std::vector<std::unique_ptr<stage>> stages;
+
+        activations_tuple acts; // [slot * micro_batch + b]
+        activations_tuple errs; // error at each layer's outputs; element 0 unused
+        gradients_tuple grads;
+
+        // Written by train() before it hands out the slots; the queues publish them.
+        std::vector<slot> slots;
+        std::size_t in_flight = 0;
+        float_t rate = 0;
+        std::atomic<std::size_t> applied{0};
+
+        template <typename F, std::size_t... L>
+        static void visit(std::size_t first, std::size_t last, F &&func, std::index_sequence<L...>)
+        {
+            ((L >= first && L <= last ? func(std::integral_constant<std::size_t, L>{}) : void()), ...);
+        }
+
+        template <std::size_t... L>
+        void allocate(std::index_sequence<L...>)
+        {
+            std::size_t const n = micro_batch * micro_batches;
+            std::get<0>(acts).resize(n);
+            ((std::get<L + 1>(acts).resize(n), std::get<L + 1>(errs).resize(n)), ...);
+            ((std::get<L>(grads).reset(new typename layer_t<L>::gradient_t())), ...);
+        }
+
+        void forward(std::size_t s, uint32_t k)
+        {
+            stage &st = *stages[s];
+            slot const &sl = slots[k];
+            std::size_t const offset = k * micro_batch;
+
+            if (s == 0)
+            {
+                for (std::size_t b = 0; b < sl.n; ++b)
+                {
+                    auto &x = std::get<0>(acts)[offset + b];
+                    for (std::size_t i = 0; i < Model::inputs(); ++i)
+                        x[i] = sl.input[b * Model::inputs() + i];
+                    x[Model::inputs()] = 1;
+                }
+            }
+
+            visit(st.first, st.last, [&](auto l)
+                  {
+                      constexpr std::size_t L = decltype(l)::value;
+                      model.template layer<L>().feed_batch(&std::get<L>(acts)[offset], &std::get<L + 1>(acts)[offset], sl.n); },
+                  std::make_index_sequence<DEPTH>{});
+
+            if (s + 1 < stages.size())
+            {
+                stages[s + 1]->forward.push(k);
+                return;
+            }
+            for (std::size_t b = 0; b < sl.n; ++b)
+            {
+                auto const &out = std::get<DEPTH>(acts)[offset + b];
+                auto &err = std::get<DEPTH>(errs)[offset + b];
+                for (std::size_t o = 0; o < Model::outputs(); ++o)
+                    err[o] = sl.answer[b * Model::outputs() + o] - out[o];
+            }
+            backward(s, k);
+        }
+
+        void backward(std::size_t s, uint32_t k)
+        {
+            stage &st = *stages[s];
+            std::size_t const n = slots[k].n, offset = k * micro_batch;
+
+            visit(st.first, st.last, [&](auto l)
+                  {
+                      constexpr std::size_t L = decltype(l)::value;
+                      auto *back = L == 0 ? nullptr : &std::get<L>(errs)[offset];
+                      model.template layer<L>().backward_batch(&std::get<L>(acts)[offset], &std::get<L + 1>(acts)[offset],
+                                                               &std::get<L + 1>(errs)[offset], *std::get<L>(grads), back, n); },
+                  makeIndexSequenceReverse<DEPTH>{});
+
+            if (s > 0)
+                stages[s - 1]->backward.push(k);
+
+            if (++st.done < in_flight)
+                return;
+            st.done = 0;
+            visit(st.first, st.last, [&](auto l)
+                  {
+                      constexpr std::size_t L = decltype(l)::value;
+                      model.template layer<L>().apply_gradient(*std::get<L>(grads), rate); },
+                  std::make_index_sequence<DEPTH>{});
+            applied.fetch_add(1, std::memory_order_release);
+        }
+
+        void run_stage(std::size_t s)
+        {
+            stage &st = *stages[s];
+            unsigned spins = 0;
+            uint32_t k;
+            for (;;)
+            {
+                if (st.backward.try_pop(k))
+                {
+                    detail::follow_denormal_mode();
+                    backward(s, k);
+                    spins = 0;
+                }
+                else if (st.forward.try_pop(k))
+                {
+                    if (k == STOP)
+                    {
+                        if (s + 1 < stages.size())
+                            stages[s + 1]->forward.push(STOP);
+                        return;
+                    }
+                    detail::follow_denormal_mode();
+                    forward(s, k);
+                    spins = 0;
+                }
+                else
+                {
+                    streaming::detail::backoff(spins);
+                }
+            }
+        }
+
+    public:
+        // n_stages is clamped to [1, depth()]. A mini-batch is micro_batches micro-batches of
+        // micro_batch samples.
+        PipelineTrainer(Model &model, std::size_t n_stages, std::size_t micro_batch = 8, std::size_t micro_batches = 8)
+            : model(model), micro_batch(micro_batch ? micro_batch : 1), micro_batches(micro_batches ? micro_batches : 1),
+              slots(this->micro_batches)
+        {
+            allocate(std::make_index_sequence<DEPTH>{});
+
+            // Cut where the running weight count passes each stage's share, keeping at least
+            // one layer for every remaining stage.
+            std::size_t const S = std::max<std::size_t>(1, std::min(n_stages, DEPTH));
+            auto const widths = Model::topology();
+            std::size_t total = 0;
+            for (std::size_t l = 0; l < DEPTH; ++l)
+                total += (widths[l] + 1) * widths[l + 1];
+
+            std::size_t first = 0, running = 0;
+            for (std::size_t l = 0; l < DEPTH; ++l)
+            {
+                running += (widths[l] + 1) * widths[l + 1];
+                std::size_t const s = stages.size();
+                bool const last_layer = l + 1 == DEPTH;
+                bool const must_cut = DEPTH - (l + 1) == S - (s + 1);
+                if (last_layer || (s + 1 < S && (running * S >= total * (s + 1) || must_cut)))
+                {
+                    stages.emplace_back(new stage(first, l, this->micro_batches + 1));
+                    first = l + 1;
+                }
+            }
+            for (std::size_t s = 0; s < stages.size(); ++s)
+                stages[s]->thread = std::thread([this, s]
+                                                { run_stage(s); });
+        }
+
+        ~PipelineTrainer()
+        {
+            stages.front()->forward.push(STOP);
+            for (auto &st : stages)
+                st->thread.join();
+        }
+
+        PipelineTrainer(PipelineTrainer const &) = delete;
+        PipelineTrainer &operator=(PipelineTrainer const &) = delete;
+
+        // Trains on n row-major samples in order, one weight update per mini-batch (the last
+        // one may be short). Returns after the last update has been applied.
+        void train(float_t const input[], float_t const answer[], std::size_t n, float_t rate)
+        {
+            std::size_t const mini_batch = micro_batch * micro_batches;
+            for (std::size_t begin = 0; begin < n; begin += mini_batch)
+            {
+                std::size_t const count = std::min(mini_batch, n - begin);
+                in_flight = (count + micro_batch - 1) / micro_batch;
+                this->rate = rate;
+                for (std::size_t k = 0; k < in_flight; ++k)
+                {
+                    std::size_t const first = begin + k * micro_batch;
+                    slots[k] = {input + first * Model::inputs(), answer + first * Model::outputs(), std::min(micro_batch, n - first)};
+                }
+
+                applied.store(0, std::memory_order_relaxed);
+                for (std::size_t k = 0; k < in_flight; ++k)
+                    stages.front()->forward.push((uint32_t)k);
+
+                unsigned spins = 0;
+                while (applied.load(std::memory_order_acquire) < stages.size())
+                    streaming::detail::backoff(spins);
+            }
+        }
+
+        std::size_t n_stages() const { return stages.size(); }
+
+        // First and last layer of stage s.
+        std::pair<std::size_t, std::size_t> stage_layers(std::size_t s) const { return {stages[s]->first, stages[s]->last}; }
+    };
+};
+
+#endif
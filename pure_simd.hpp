@@ -39,6 +39,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <climits>
 #include <functional>
 #include <cmath>
+#include <type_traits>
+#include <utility>
 
 namespace pure_simd
 {
@@ -87,7 +89,7 @@ namespace pure_simd
 
         constexpr T &operator[](size_t pos) { return data[pos]; }
 
-        constexpr T operator[](size_t pos) const { return data[pos]; }
+        constexpr const T &operator[](size_t pos) const { return data[pos]; }
 
         constexpr iterator begin() { return data; }
 
@@ -624,6 +626,162 @@ namespace pure_simd
         return detail::sum_impl(x, init, index_sequence_of<V>{});
     }
 
+    // Lazy expressions.
+    //
+    // The operators above evaluate eagerly: every operand is copied and every
+    // intermediate result is a full vector. lazy(v) wraps a vector by reference, and
+    // +, -, * on wrapped operands build an expression tree instead, evaluated element by
+    // element only when it is consumed:
+    //
+    //     sum(lazy(xs) * ys, init)              fused multiply and reduce
+    //     assign(xs, lazy(xs) + ys * broadcast<decltype(ys)>(s))   in-place update
+    //
+    // Expressions hold references, so build and consume them in the same statement.
+    namespace expr
+    {
+        template <typename V>
+        struct ref
+        {
+            using value_type = typename V::value_type;
+            static constexpr size_t size() { return V::size(); }
+
+            V const &xs;
+
+            constexpr value_type operator[](size_t i) const { return xs.data[i]; }
+        };
+
+        template <typename T, size_t N>
+        struct broadcast
+        {
+            using value_type = T;
+            static constexpr size_t size() { return N; }
+
+            T x;
+
+            constexpr value_type operator[](size_t) const { return x; }
+        };
+
+        template <typename Op, typename L, typename R>
+        struct binary
+        {
+            using value_type = decltype(Op{}(std::declval<typename L::value_type>(), std::declval<typename R::value_type>()));
+            static constexpr size_t size() { return L::size(); }
+
+            L l;
+            R r;
+
+            constexpr value_type operator[](size_t i) const { return Op{}(l[i], r[i]); }
+        };
+
+        template <typename E>
+        struct is_expression : std::false_type
+        {
+        };
+
+        template <typename V>
+        struct is_expression<ref<V>> : std::true_type
+        {
+        };
+
+        template <typename T, size_t N>
+        struct is_expression<broadcast<T, N>> : std::true_type
+        {
+        };
+
+        template <typename Op, typename L, typename R>
+        struct is_expression<binary<Op, L, R>> : std::true_type
+        {
+        };
+
+        template <typename X>
+        constexpr auto operand(X const &x)
+        {
+            if constexpr (is_expression<X>::value)
+                return x;
+            else
+                return ref<X>{x};
+        }
+
+        // At least one side must already be an expression; the other may be a plain vector.
+        template <typename A, typename B>
+        using enable_lazy = std::enable_if_t<
+            (is_expression<A>::value || is_expression<B>::value) &&
+            (is_expression<A>::value || is_vector<A>::value) &&
+            (is_expression<B>::value || is_vector<B>::value) &&
+            A::size() == B::size()>;
+
+#define LAZY_BINARY_OPERATOR(op, functor)                                                               \
+    template <typename A, typename B, typename = enable_lazy<A, B>>                                     \
+    constexpr auto operator op(A const &a, B const &b)                                                  \
+    {                                                                                                   \
+        return binary<functor, decltype(operand(a)), decltype(operand(b))>{operand(a), operand(b)}; \
+    }
+
+        LAZY_BINARY_OPERATOR(+, std::plus<>)
+
+        LAZY_BINARY_OPERATOR(-, std::minus<>)
+
+        LAZY_BINARY_OPERATOR(*, std::multiplies<>)
+
+#undef LAZY_BINARY_OPERATOR
+
+        template <size_t ACC, typename E, typename T>
+        constexpr T sum_impl(E const &e, T init)
+        {
+            // ACC independent partial sums, so consecutive multiply-adds do not wait on
+            // each other; a constant-trip inner loop the compiler turns into vector FMAs.
+            constexpr size_t N = E::size();
+            constexpr size_t FULL = N / ACC * ACC;
+            T acc[ACC] = {};
+            for (size_t i = 0; i < FULL; i += ACC)
+                for (size_t k = 0; k < ACC; ++k)
+                    acc[k] += e[i + k];
+            for (size_t i = FULL; i < N; ++i)
+                init += e[i];
+            for (size_t k = 0; k < ACC; ++k)
+                init += acc[k];
+            return init;
+        }
+
+        template <typename V, typename E>
+        constexpr void assign_impl(V &dst, E const &e)
+        {
+            for (size_t i = 0; i < V::size(); ++i)
+                dst.data[i] = e[i];
+        }
+
+    } // namespace expr
+
+    template <typename V, typename = must_be_vector<V>>
+    constexpr auto lazy(V const &xs)
+    {
+        return expr::ref<V>{xs};
+    }
+
+    template <typename V, typename T, typename = must_be_vector<V>>
+    constexpr auto broadcast(T x)
+    {
+        return expr::broadcast<typename V::value_type, V::size()>{static_cast<typename V::value_type>(x)};
+    }
+
+    // ACC partial sums in flight; 0, the default, keeps two registers' worth of the
+    // expression's value type.
+    template <size_t ACC = 0, typename E, typename T, typename = std::enable_if_t<expr::is_expression<E>::value>>
+    constexpr T sum(E const &e, T init)
+    {
+        constexpr size_t wanted = ACC ? ACC : 2 * native_vectorsize<typename E::value_type>();
+        constexpr size_t acc = E::size() < wanted ? E::size() : wanted;
+        return expr::sum_impl<(acc > 0 ? acc : 1)>(e, init);
+    }
+
+    // Evaluates e straight into dst. e may read dst itself: element i is read before it is written.
+    template <typename V, typename E, typename = must_be_vector<V>, typename = std::enable_if_t<expr::is_expression<E>::value>>
+    constexpr void assign(V &dst, E const &e)
+    {
+        static_assert(V::size() == E::size(), "");
+        expr::assign_impl(dst, e);
+    }
+
     // Algorithms: transform, accumulate, and inner_product.
     template <size_t VectorSize, typename F, typename T, typename S>
     constexpr void transform(const S *src, size_t n, T *dst, F func)
@@ -0,0 +1,404 @@
+#ifndef __REGISTRY_H__
+#define __REGISTRY_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "checkpoint.hpp"
+#include "serving.hpp"
+
+// Many small models served from one process.
+//
+// MappedModel runs a checkpoint (checkpoint.hpp) in place: the file is mmap'ed read-only,
+// the topology is taken from its header and the weights are used straight from the
+// mapping, so any number of topologies can be served without a compile-time MLP type.
+//
+// ModelRegistry looks models up by id, maps their file on the first request and keeps
+// the most recently used ones under a byte budget. Ids are hashed to shards, each with
+// its own lock, LRU list and share of the budget, so concurrent lookups of different
+// models rarely contend. Evicted models stay valid for callers still holding them; the
+// file is unmapped when the last reference goes.
+//
+// RegistryServer batches concurrent requests: a worker takes a batch from the queue,
+// groups it by model id and runs one predict_batch per model.
+
+namespace meta_ai
+{
+    template <typename float_t>
+    class MappedModel
+    {
+        void *map = MAP_FAILED;
+        std::size_t map_bytes = 0;
+        std::vector<std::size_t> widths;
+        std::vector<float_t const *> weights; // layer l: widths[l + 1] rows of widths[l] + 1
+        std::size_t widest = 0;
+
+        MappedModel() = default;
+
+    public:
+        ~MappedModel()
+        {
+            if (map != MAP_FAILED)
+                munmap(map, map_bytes);
+        }
+
+        MappedModel(MappedModel const &) = delete;
+        MappedModel &operator=(MappedModel const &) = delete;
+
+        // Null if the file is missing, truncated or not a checkpoint of float_t weights.
+        static std::shared_ptr<MappedModel const> open(char const *path)
+        {
+            int const fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return nullptr;
+            struct stat st;
+            std::shared_ptr<MappedModel> model(new MappedModel);
+            if (fstat(fd, &st) == 0 && (std::size_t)st.st_size >= sizeof(checkpoint_header))
+            {
+                model->map_bytes = st.st_size;
+                model->map = mmap(nullptr, model->map_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            close(fd);
+            if (model->map == MAP_FAILED)
+                return nullptr;
+
+            checkpoint_header const &header = *(checkpoint_header const *)model->map;
+            if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 || header.version != 1 ||
+                header.float_size != sizeof(float_t) || header.n_widths < 2 || header.n_widths > checkpoint_header::MAX_WIDTHS)
+                return nullptr;
+
+            std::size_t n = 0;
+            for (std::size_t l = 0; l < header.n_widths; ++l)
+            {
+                if (header.widths[l] == 0)
+                    return nullptr;
+                model->widths.push_back(header.widths[l]);
+                model->widest = std::max<std::size_t>(model->widest, header.widths[l]);
+            }
+            for (std::size_t l = 0; l + 1 < header.n_widths; ++l)
+                n += (model->widths[l] + 1) * model->widths[l + 1];
+            if (header.payload_bytes != n * sizeof(float_t) || model->map_bytes < sizeof(header) + header.payload_bytes)
+                return nullptr;
+
+            float_t const *w = (float_t const *)((char const *)model->map + sizeof(header));
+            for (std::size_t l = 0; l + 1 < header.n_widths; ++l)
+            {
+                model->weights.push_back(w);
+                w += (model->widths[l] + 1) * model->widths[l + 1];
+            }
+            madvise(model->map, model->map_bytes, MADV_WILLNEED);
+            return model;
+        }
+
+        std::size_t inputs() const { return widths.front(); }
+        std::size_t outputs() const { return widths.back(); }
+        std::vector<std::size_t> const &topology() const { return widths; }
+
+        // Whole pages mapped, i.e. what the model costs against a registry budget.
+        std::size_t bytes() const
+        {
+            std::size_t const page = sysconf(_SC_PAGESIZE);
+            return (map_bytes + page - 1) / page * page;
+        }
+
+        // n row-major samples in, n row-major predictions out. Safe to call concurrently.
+        void predict_batch(float_t const input[], std::size_t n, float_t output[]) const
+        {
+            thread_local std::vector<float_t> scratch;
+            scratch.resize(2 * n * widest);
+            float_t *from = scratch.data(), *to = from + n * widest;
+
+            float_t const *x = input;
+            for (std::size_t l = 0; l + 1 < widths.size(); ++l)
+            {
+                std::size_t const in = widths[l], out = widths[l + 1];
+                float_t *y = l + 2 == widths.size() ? output : to;
+                // Each row of weights is read once and used for the whole batch.
+                for (std::size_t i = 0; i < out; ++i)
+                {
+                    float_t const *row = weights[l] + i * (in + 1);
+                    for (std::size_t b = 0; b < n; ++b)
+                    {
+                        float_t const *xb = x + b * in;
+                        float_t sum = row[in];
+                        for (std::size_t k = 0; k < in; ++k)
+                            sum += row[k] * xb[k];
+                        y[b * out + i] = 1 / (1 + ((float_t)(exp(-sum))));
+                    }
+                }
+                x = y;
+                std::swap(from, to);
+            }
+        }
+    };
+
+    struct registry_stats
+    {
+        uint64_t hits = 0, misses = 0, evictions = 0, load_failures = 0;
+        std::size_t resident_models = 0, resident_bytes = 0;
+        double load_us_mean = 0, load_us_p50 = 0, load_us_p99 = 0, load_us_max = 0;
+
+        double hit_rate() const { return hits + misses ? (double)hits / (hits + misses) : 0; }
+    };
+
+    template <typename float_t>
+    class ModelRegistry
+    {
+    public:
+        using model_ptr = std::shared_ptr<MappedModel<float_t> const>;
+        using resolver = std::function<std::string(std::string const &id)>;
+
+    private:
+        struct entry
+        {
+            std::string id;
+            model_ptr model;
+        };
+
+        struct alignas(64) shard
+        {
+            std::mutex lock;
+            std::list<entry> lru; // most recently used first
+            std::unordered_map<std::string, typename std::list<entry>::iterator> index;
+            std::size_t bytes = 0;
+        };
+
+        resolver const path_of;
+        std::size_t const shard_budget;
+        std::vector<std::unique_ptr<shard>> shards;
+
+        std::atomic<uint64_t> hits{0}, misses{0}, evictions{0}, failures{0};
+
+        // Load latencies: bucket b counts loads that took [2^b, 2^(b+1)) ns.
+        static constexpr std::size_t LATENCY_BUCKETS = 40;
+        std::atomic<uint64_t> latency[LATENCY_BUCKETS] = {};
+        std::atomic<uint64_t> load_ns_total{0}, load_ns_max{0}, loads{0};
+
+        void record_load(uint64_t ns)
+        {
+            std::size_t b = 0;
+            while (b + 1 < LATENCY_BUCKETS && (ns >> (b + 1)))
+                ++b;
+            ++latency[b];
+            ++loads;
+            load_ns_total += ns;
+            uint64_t max = load_ns_max.load();
+            while (ns > max && !load_ns_max.compare_exchange_weak(max, ns))
+                ;
+        }
+
+        // Upper bound of the bucket holding quantile q, in microseconds.
+        double latency_quantile(double q) const
+        {
+            uint64_t const total = loads.load();
+            if (!total)
+                return 0;
+            uint64_t seen = 0;
+            for (std::size_t b = 0; b < LATENCY_BUCKETS; ++b)
+            {
+                seen += latency[b].load();
+                if (seen >= q * total)
+                    return (double)(2ull << b) / 1000;
+            }
+            return (double)(2ull << (LATENCY_BUCKETS - 1)) / 1000;
+        }
+
+    public:
+        // memory_budget is split evenly between the shards. A shard always keeps its most
+        // recent model, even one larger than its share.
+        ModelRegistry(resolver path_of, std::size_t memory_budget, std::size_t n_shards = 16)
+            : path_of(std::move(path_of)), shard_budget(memory_budget / (n_shards ? n_shards : 1))
+        {
+            for (std::size_t s = 0; s < (n_shards ? n_shards : 1); ++s)
+                shards.emplace_back(new shard);
+        }
+
+        // Model files named <directory>/<id>.ckpt.
+        static resolver directory(std::string const &dir)
+        {
+            return [dir](std::string const &id)
+            { return dir + "/" + id + ".ckpt"; };
+        }
+
+        // The model for id, mapped on a miss; null if it cannot be loaded. The file is mapped
+        // outside the shard lock, so a slow load does not stall lookups of other models.
+        model_ptr get(std::string const &id)
+        {
+            shard &sh = *shards[std::hash<std::string>{}(id) % shards.size()];
+            {
+                std::lock_guard<std::mutex> guard(sh.lock);
+                auto const it = sh.index.find(id);
+                if (it != sh.index.end())
+                {
+                    sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+                    ++hits;
+                    return it->second->model;
+                }
+            }
+
+            ++misses;
+            auto const t0 = std::chrono::steady_clock::now();
+            model_ptr model = MappedModel<float_t>::open(path_of(id).c_str());
+            record_load(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+            if (!model)
+            {
+                ++failures;
+                return nullptr;
+            }
+
+            std::lock_guard<std::mutex> guard(sh.lock);
+            auto const it = sh.index.find(id);
+            if (it != sh.index.end())
+            {
+                // Loaded concurrently by another caller: keep theirs, drop ours.
+                sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+                return it->second->model;
+            }
+            sh.lru.push_front({id, model});
+            sh.index[id] = sh.lru.begin();
+            sh.bytes += model->bytes();
+            while (sh.bytes > shard_budget && sh.lru.size() > 1)
+            {
+                entry const &victim = sh.lru.back();
+                sh.bytes -= victim.model->bytes();
+                sh.index.erase(victim.id);
+                sh.lru.pop_back();
+                ++evictions;
+            }
+            return model;
+        }
+
+        registry_stats stats()
+        {
+            registry_stats s;
+            s.hits = hits;
+            s.misses = misses;
+            s.evictions = evictions;
+            s.load_failures = failures;
+            for (auto &sh : shards)
+            {
+                std::lock_guard<std::mutex> guard(sh->lock);
+                s.resident_models += sh->lru.size();
+                s.resident_bytes += sh->bytes;
+            }
+            uint64_t const n = loads.load();
+            s.load_us_mean = n ? (double)load_ns_total / n / 1000 : 0;
+            s.load_us_p50 = latency_quantile(0.5);
+            s.load_us_p99 = latency_quantile(0.99);
+            s.load_us_max = (double)load_ns_max / 1000;
+            return s;
+        }
+    };
+
+    // Request batching in front of a ModelRegistry. submit() queues a request and returns
+    // a future that is set, to false if the model could not be loaded, once output holds
+    // the prediction. input and output must stay valid until then and be sized for the
+    // model's topology.
+    template <typename float_t>
+    class RegistryServer
+    {
+        struct request
+        {
+            std::string model;
+            float_t const *input;
+            float_t *output;
+            std::promise<bool> done;
+            std::chrono::steady_clock::time_point arrival;
+        };
+
+        ModelRegistry<float_t> &registry;
+        serving::RequestBatcher<request> batcher;
+        std::vector<std::thread> workers;
+        std::atomic<uint64_t> groups{0}, served{0};
+
+        void serve()
+        {
+            std::vector<request> batch;
+            std::vector<std::size_t> order;
+            std::vector<float_t> inputs, outputs;
+            while (batcher.pop_batch(batch))
+            {
+                order.resize(batch.size());
+                for (std::size_t i = 0; i < order.size(); ++i)
+                    order[i] = i;
+                std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+                                 { return batch[a].model < batch[b].model; });
+
+                for (std::size_t g = 0; g < order.size();)
+                {
+                    std::size_t end = g + 1;
+                    while (end < order.size() && batch[order[end]].model == batch[order[g]].model)
+                        ++end;
+
+                    auto const model = registry.get(batch[order[g]].model);
+                    if (model)
+                    {
+                        std::size_t const n = end - g, in = model->inputs(), out = model->outputs();
+                        inputs.resize(n * in);
+                        outputs.resize(n * out);
+                        for (std::size_t r = 0; r < n; ++r)
+                            memcpy(&inputs[r * in], batch[order[g + r]].input, in * sizeof(float_t));
+                        model->predict_batch(inputs.data(), n, outputs.data());
+                        for (std::size_t r = 0; r < n; ++r)
+                            memcpy(batch[order[g + r]].output, &outputs[r * out], out * sizeof(float_t));
+                    }
+                    for (std::size_t r = g; r < end; ++r)
+                        batch[order[r]].done.set_value((bool)model);
+                    ++groups;
+                    served += end - g;
+                    g = end;
+                }
+            }
+        }
+
+    public:
+        RegistryServer(ModelRegistry<float_t> &registry, std::size_t n_workers, std::size_t max_batch = 64,
+                       std::chrono::microseconds max_delay = std::chrono::microseconds(100))
+            : registry(registry), batcher(max_batch, max_delay, 64 * max_batch)
+        {
+            for (std::size_t w = 0; w < (n_workers ? n_workers : 1); ++w)
+                workers.emplace_back([this]
+                                     { serve(); });
+        }
+
+        ~RegistryServer()
+        {
+            batcher.close();
+            for (auto &worker : workers)
+                worker.join();
+        }
+
+        std::future<bool> submit(std::string model, float_t const *input, float_t *output)
+        {
+            request r{std::move(model), input, output, {}, std::chrono::steady_clock::now()};
+            std::future<bool> done = r.done.get_future();
+            if (!batcher.push(std::move(r)))
+            {
+                std::promise<bool> closed;
+                closed.set_value(false);
+                return closed.get_future();
+            }
+            return done;
+        }
+
+        // Average requests per predict_batch call.
+        double mean_group_size() const { return groups ? (double)served / groups : 0; }
+    };
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef __SAMPLING_H__
+#define __SAMPLING_H__
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+// Loss-aware importance sampling of training rows.
+//
+// ImportanceSampler keeps an exponential moving average of every row's loss, as returned
+// by MLP::train from its forward pass, and draws rows in proportion to it from a sum tree
+// (O(log n) per draw and per update), mixed with a uniform share so that rows that look
+// fit are still revisited. Each draw comes with an importance weight 1 / (n P(row)), to
+// be multiplied into the learning rate: the expected weighted update is then the
+// uniform one, while the draws go to the rows that still have something to teach. The
+// uniform share bounds the weight by 1 / uniform.
+
+namespace meta_ai
+{
+    // Priorities of n items in a complete binary tree of partial sums: leaves at
+    // [capacity, 2 capacity), node i holds the sum of nodes 2i and 2i + 1.
+    class SumTree
+    {
+        std::size_t capacity = 1;
+        std::vector<double> nodes;
+
+    public:
+        explicit SumTree(std::size_t n)
+        {
+            while (capacity < n)
+                capacity *= 2;
+            nodes.assign(2 * capacity, 0);
+        }
+
+        double total() const { return nodes[1]; }
+        double get(std::size_t i) const { return nodes[capacity + i]; }
+
+        void set(std::size_t i, double priority)
+        {
+            std::size_t node = capacity + i;
+            double const change = priority - nodes[node];
+            for (; node; node /= 2)
+                nodes[node] += change;
+        }
+
+        // Recomputes every sum from the leaves, which clears the rounding drift of set().
+        void rebuild()
+        {
+            for (std::size_t node = capacity - 1; node; --node)
+                nodes[node] = nodes[2 * node] + nodes[2 * node + 1];
+        }
+
+        // Item whose cumulative priority range holds u, for u in [0, total()).
+        std::size_t find(double u) const
+        {
+            std::size_t node = 1;
+            while (node < capacity)
+            {
+                node *= 2;
+                if (u >= nodes[node] && nodes[node + 1] > 0)
+                {
+                    u -= nodes[node];
+                    ++node;
+                }
+            }
+            return node - capacity;
+        }
+    };
+
+    struct sampler_config
+    {
+        double smoothing = 0.7; // EMA weight of the previous loss
+        double exponent = 0.5;  // priority = loss^exponent; 0.5 tracks the error, i.e. the gradient size
+        double uniform = 0.5;   // share of draws made uniformly
+        double floor = 1e-4;    // added to every loss, so no row's probability reaches 0
+    };
+
+    struct weighted_row
+    {
+        uint32_t row;
+        float weight; // importance weight, for the learning rate
+    };
+
+    class ImportanceSampler
+    {
+        sampler_config const config;
+        std::vector<float> losses; // EMA per row; negative until first seen
+        SumTree tree;
+        uint64_t state;
+        std::size_t updates = 0;
+
+        double uniform_double()
+        {
+            // xorshift64*, top 53 bits.
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return (double)((state * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+    public:
+        // Rows start at the same priority, so the first draws are uniform.
+        explicit ImportanceSampler(std::size_t n, sampler_config const &config = {}, uint64_t seed = 1)
+            : config(config), losses(n, -1), tree(n), state(seed ? seed : 1)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+                tree.set(i, 1);
+        }
+
+        std::size_t size() const { return losses.size(); }
+
+        // Probability of drawing row i next.
+        double probability(std::size_t i) const
+        {
+            double const n = (double)losses.size();
+            return (1 - config.uniform) * tree.get(i) / tree.total() + config.uniform / n;
+        }
+
+        weighted_row next()
+        {
+            std::size_t row;
+            if (uniform_double() < config.uniform)
+                row = std::min(losses.size() - 1, (std::size_t)(uniform_double() * losses.size()));
+            else
+                row = std::min(losses.size() - 1, tree.find(uniform_double() * tree.total()));
+            return {(uint32_t)row, (float)(1 / (losses.size() * probability(row)))};
+        }
+
+        // Records the loss the forward pass measured on row i.
+        void update(std::size_t i, double loss)
+        {
+            float &ema = losses[i];
+            ema = ema < 0 ? (float)loss : (float)(config.smoothing * ema + (1 - config.smoothing) * loss);
+            tree.set(i, pow(ema + config.floor, config.exponent));
+            if (++updates % (16 * losses.size() + 1024) == 0)
+                tree.rebuild();
+        }
+
+        float loss(std::size_t i) const { return losses[i]; }
+    };
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "mlp.hpp"
+#include "iris.hpp"
+#include "serving.hpp"
+#include <signal.h>
+#include <poll.h>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <unordered_set>
+
+// Local inference server. Trains the Iris model at startup, then answers requests
+// (see serving.hpp for the protocol) by gathering them into batches for predict_batch.
+//
+//   ./server [endpoint] [workers] [max_batch] [max_delay_us]
+//   endpoint defaults to unix:/tmp/meta_ai.sock; tcp:PORT listens on loopback.
+
+#define epochs 20000
+#define learning_rate 0.1
+#define rand_seed 0
+
+namespace mai = meta_ai;
+namespace srv = meta_ai::serving;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>>;
+using Request = srv::pending_request<float, Model::inputs()>;
+
+Model mlp;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+std::atomic<bool> stopping{false};
+std::atomic<unsigned long> served{0};
+std::atomic<unsigned long> batches{0};
+
+// Connections whose reader is still running; shutdown only has to wake these.
+std::mutex live_lock;
+std::condition_variable live_done;
+std::unordered_set<srv::connection *> live;
+
+void on_signal(int) { stopping = true; }
+
+void read_requests(std::shared_ptr<srv::connection> conn, srv::RequestBatcher<Request> *batcher)
+{
+    srv::request_header header;
+    while (srv::read_full(conn->fd, &header, sizeof(header)))
+    {
+        if (header.n_values != Model::inputs())
+        {
+            float discard;
+            for (int k = 0; k < header.n_values; ++k)
+            {
+                if (!srv::read_full(conn->fd, &discard, sizeof(discard)))
+                    return;
+            }
+            srv::response_header response = {header.id, 0, srv::STATUS_BAD_SHAPE};
+            std::lock_guard<std::mutex> lk(conn->write_lock);
+            srv::write_full(conn->fd, &response, sizeof(response));
+            continue;
+        }
+
+        Request request;
+        request.conn = conn;
+        request.id = header.id;
+        if (!srv::read_full(conn->fd, request.input, sizeof(request.input)))
+            return;
+        request.arrival = std::chrono::steady_clock::now();
+        if (!batcher->push(std::move(request)))
+            return;
+    }
+}
+
+// Detached reader thread: drops the connection once the client is gone, so its fd is
+// closed as soon as the last pending reply has been written.
+void reader_main(std::shared_ptr<srv::connection> conn, srv::RequestBatcher<Request> *batcher)
+{
+    read_requests(conn, batcher);
+    std::unique_lock<std::mutex> lk(live_lock);
+    live.erase(conn.get());
+    conn.reset();
+    std::notify_all_at_thread_exit(live_done, std::move(lk));
+}
+
+void serve_batches(srv::RequestBatcher<Request> *batcher)
+{
+    struct reply
+    {
+        srv::response_header header;
+        float output[Model::outputs()];
+    };
+    static_assert(sizeof(reply) == sizeof(srv::response_header) + Model::outputs() * sizeof(float), "");
+
+    std::vector<Request> batch;
+    std::vector<float> inputs;
+    std::vector<float> outputs;
+    std::vector<reply> replies;
+    std::vector<bool> sent;
+
+    while (batcher->pop_batch(batch))
+    {
+        std::size_t const n = batch.size();
+        inputs.resize(n * Model::inputs());
+        outputs.resize(n * Model::outputs());
+        for (std::size_t b = 0; b < n; ++b)
+            memcpy(&inputs[b * Model::inputs()], batch[b].input, sizeof(batch[b].input));
+
+        mlp.predict_batch(inputs.data(), n, outputs.data());
+
+        // Scatter: one write per connection present in the batch.
+        sent.assign(n, false);
+        for (std::size_t b = 0; b < n; ++b)
+        {
+            if (sent[b])
+                continue;
+            replies.clear();
+            for (std::size_t c = b; c < n; ++c)
+            {
+                if (sent[c] || batch[c].conn != batch[b].conn)
+                    continue;
+                reply r;
+                r.header = {batch[c].id, (uint16_t)Model::outputs(), srv::STATUS_OK};
+                memcpy(r.output, &outputs[c * Model::outputs()], sizeof(r.output));
+                replies.push_back(r);
+                sent[c] = true;
+            }
+            std::lock_guard<std::mutex> lk(batch[b].conn->write_lock);
+            srv::write_full(batch[b].conn->fd, replies.data(), replies.size() * sizeof(reply));
+        }
+
+        served += n;
+        batches += 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char const *spec = argc > 1 ? argv[1] : "unix:/tmp/meta_ai.sock";
+    int const workers = argc > 2 ? atoi(argv[2]) : 2;
+    int const max_batch = argc > 3 ? atoi(argv[3]) : 64;
+    int const max_delay_us = argc > 4 ? atoi(argv[4]) : 200;
+
+    srv::endpoint ep;
+    if (!srv::parse_endpoint(spec, ep))
+    {
+        printf("Bad endpoint: %s\n", spec);
+        return EXIT_FAILURE;
+    }
+
+    srand(rand_seed);
+    readIris(feat, label);
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+
+    CHECK_TIME(
+        for (int i = 0; i < epochs; i++) {
+            shuffle(order, rows);
+            for (int j = 0; j < rows; j++)
+            {
+                int row = order[j];
+                mlp.train(feat + row * cols, label + row * out_cols, learning_rate);
+            }
+        })
+
+    int listener = srv::listen_on(ep);
+    if (listener < 0)
+    {
+        printf("Cannot listen on %s: %s\n", spec, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    srv::RequestBatcher<Request> batcher(max_batch, std::chrono::microseconds(max_delay_us), 64 * max_batch);
+
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w)
+        pool.emplace_back(serve_batches, &batcher);
+
+    printf("Serving on %s with %d workers, max batch %d, max delay %d us\n", spec, workers, max_batch, max_delay_us);
+    fflush(stdout);
+
+    while (!stopping)
+    {
+        pollfd pfd = {listener, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            // Out of descriptors: the pending connection keeps the listener readable, so
+            // wait for readers to release some instead of spinning on poll.
+            if (errno == EMFILE || errno == ENFILE)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        srv::no_delay(fd, ep);
+        auto conn = std::make_shared<srv::connection>(fd);
+        {
+            std::lock_guard<std::mutex> lk(live_lock);
+            live.insert(conn.get());
+        }
+        std::thread(reader_main, std::move(conn), &batcher).detach();
+    }
+
+    batcher.close();
+    {
+        std::unique_lock<std::mutex> lk(live_lock);
+        for (srv::connection *conn : live)
+            shutdown(conn->fd, SHUT_RDWR);
+        live_done.wait(lk, []
+                       { return live.empty(); });
+    }
+    for (auto &worker : pool)
+        worker.join();
+    close(listener);
+    if (!ep.tcp)
+        unlink(ep.path);
+
+    unsigned long const total = served;
+    printf("Served %lu requests in %lu batches (%.2f per batch)\n", total, (unsigned long)batches,
+           batches ? (double)total / batches : 0.0);
+
+    return EXIT_SUCCESS;
+}
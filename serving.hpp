@@ -0,0 +1,289 @@
+#ifndef __SERVING_H__
+#define __SERVING_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Building blocks shared by server.cpp and load_client.cpp: the wire protocol,
+// socket helpers and the queue that gathers concurrent requests into batches.
+
+namespace meta_ai
+{
+    namespace serving
+    {
+        // Wire format (host byte order, no padding):
+        //   request:  request_header followed by n_values floats (the model inputs)
+        //   response: response_header followed by n_values floats (the predictions)
+        // Requests on one connection may be answered out of order; match them by id.
+        struct request_header
+        {
+            uint32_t id;
+            uint16_t n_values;
+            uint16_t flags;
+        };
+
+        struct response_header
+        {
+            uint32_t id;
+            uint16_t n_values;
+            uint16_t status;
+        };
+
+        static_assert(sizeof(request_header) == 8 && sizeof(response_header) == 8, "");
+
+        enum : uint16_t
+        {
+            STATUS_OK = 0,
+            STATUS_BAD_SHAPE = 1,
+        };
+
+        // "unix:/path/to.sock" or "tcp:PORT" (loopback only).
+        struct endpoint
+        {
+            bool tcp = false;
+            uint16_t port = 0;
+            char path[sizeof(sockaddr_un::sun_path)] = {};
+        };
+
+        inline bool parse_endpoint(char const *spec, endpoint &ep)
+        {
+            if (strncmp(spec, "unix:", 5) == 0 && strlen(spec + 5) < sizeof(ep.path))
+            {
+                ep.tcp = false;
+                strcpy(ep.path, spec + 5);
+                return true;
+            }
+            if (strncmp(spec, "tcp:", 4) == 0)
+            {
+                ep.tcp = true;
+                ep.port = (uint16_t)atoi(spec + 4);
+                return ep.port != 0;
+            }
+            return false;
+        }
+
+        inline void no_delay(int fd, endpoint const &ep)
+        {
+            if (ep.tcp)
+            {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+        }
+
+        inline int listen_on(endpoint const &ep)
+        {
+            int fd = socket(ep.tcp ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                return -1;
+
+            int rc;
+            if (ep.tcp)
+            {
+                int one = 1;
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                sockaddr_in addr = {};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(ep.port);
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                rc = bind(fd, (sockaddr *)&addr, sizeof(addr));
+            }
+            else
+            {
+                unlink(ep.path);
+                sockaddr_un addr = {};
+                addr.sun_family = AF_UNIX;
+                strcpy(addr.sun_path, ep.path);
+                rc = bind(fd, (sockaddr *)&addr, sizeof(addr));
+            }
+
+            if (rc < 0 || listen(fd, 128) < 0)
+            {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        inline int connect_to(endpoint const &ep)
+        {
+            int fd = socket(ep.tcp ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                return -1;
+
+            int rc;
+            if (ep.tcp)
+            {
+                sockaddr_in addr = {};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(ep.port);
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                rc = connect(fd, (sockaddr *)&addr, sizeof(addr));
+            }
+            else
+            {
+                sockaddr_un addr = {};
+                addr.sun_family = AF_UNIX;
+                strcpy(addr.sun_path, ep.path);
+                rc = connect(fd, (sockaddr *)&addr, sizeof(addr));
+            }
+
+            if (rc < 0)
+            {
+                close(fd);
+                return -1;
+            }
+            no_delay(fd, ep);
+            return fd;
+        }
+
+        // Both return false on EOF or error.
+        inline bool read_full(int fd, void *buf, size_t n)
+        {
+            char *p = (char *)buf;
+            while (n > 0)
+            {
+                ssize_t r = read(fd, p, n);
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r <= 0)
+                    return false;
+                p += r;
+                n -= (size_t)r;
+            }
+            return true;
+        }
+
+        inline bool write_full(int fd, void const *buf, size_t n)
+        {
+            char const *p = (char const *)buf;
+            while (n > 0)
+            {
+                ssize_t r = write(fd, p, n);
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r <= 0)
+                    return false;
+                p += r;
+                n -= (size_t)r;
+            }
+            return true;
+        }
+
+        // Responses for one client may be produced by several workers; they serialize on write_lock.
+        struct connection
+        {
+            int fd;
+            std::mutex write_lock;
+
+            explicit connection(int fd) : fd(fd) {}
+            ~connection() { close(fd); }
+        };
+
+        template <typename float_t, std::size_t INPUTS>
+        struct pending_request
+        {
+            std::shared_ptr<connection> conn;
+            uint32_t id;
+            std::chrono::steady_clock::time_point arrival;
+            float_t input[INPUTS];
+        };
+
+        // Gathers requests pushed by connection threads into batches for the workers.
+        // A batch is released once max_batch requests are queued or the oldest one has
+        // waited max_delay. push blocks while capacity requests are queued, which pushes
+        // back on the clients instead of buffering without bound.
+        template <typename T>
+        class RequestBatcher
+        {
+            std::mutex lock;
+            std::condition_variable not_empty;
+            std::condition_variable not_full;
+            std::deque<T> queue;
+            bool closed = false;
+
+            std::size_t const max_batch;
+            std::chrono::microseconds const max_delay;
+            std::size_t const capacity;
+
+        public:
+            RequestBatcher(std::size_t max_batch, std::chrono::microseconds max_delay, std::size_t capacity)
+                : max_batch(max_batch), max_delay(max_delay), capacity(capacity) {}
+
+            bool push(T &&item)
+            {
+                std::unique_lock<std::mutex> lk(lock);
+                not_full.wait(lk, [&]
+                              { return closed || queue.size() < capacity; });
+                if (closed)
+                    return false;
+                queue.push_back(std::move(item));
+                if (queue.size() == 1 || queue.size() >= max_batch)
+                    not_empty.notify_one();
+                return true;
+            }
+
+            // Returns false once the batcher is closed and drained.
+            bool pop_batch(std::vector<T> &batch)
+            {
+                batch.clear();
+                std::unique_lock<std::mutex> lk(lock);
+                for (;;)
+                {
+                    not_empty.wait(lk, [&]
+                                   { return closed || !queue.empty(); });
+                    if (queue.empty())
+                        return false;
+
+                    auto const deadline = queue.front().arrival + max_delay;
+                    while (!closed && !queue.empty() && queue.size() < max_batch)
+                    {
+                        if (not_empty.wait_until(lk, deadline) == std::cv_status::timeout)
+                            break;
+                    }
+
+                    // Another worker may have taken the batch while we were waiting.
+                    if (queue.empty())
+                        continue;
+
+                    std::size_t const n = queue.size() < max_batch ? queue.size() : max_batch;
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        batch.push_back(std::move(queue.front()));
+                        queue.pop_front();
+                    }
+
+                    if (!queue.empty())
+                        not_empty.notify_one();
+                    not_full.notify_all();
+                    return true;
+                }
+            }
+
+            void close()
+            {
+                std::lock_guard<std::mutex> lk(lock);
+                closed = true;
+                not_empty.notify_all();
+                not_full.notify_all();
+            }
+        };
+    };
+};
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef __SPARSE_H__
+#define __SPARSE_H__
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "mlp.hpp"
+
+// Magnitude pruning of a trained MLP and a block-sparse inference engine for the result.
+//
+// Pruning zeroes weights in place and never touches the bias column. SparseMLP then
+// keeps, for every neuron, only the BLOCK-wide runs of its input weights that still
+// hold a non-zero value, so zero blocks cost neither memory nor multiplies.
+
+namespace meta_ai
+{
+    namespace detail
+    {
+        template <typename float_t>
+        float_t magnitude_quantile(std::vector<float_t> &magnitudes, double sparsity)
+        {
+            if (magnitudes.empty() || sparsity <= 0)
+                return 0;
+            std::size_t k = (std::size_t)(sparsity * magnitudes.size());
+            if (k >= magnitudes.size())
+                return INFINITY;
+            std::nth_element(magnitudes.begin(), magnitudes.begin() + k, magnitudes.end());
+            return magnitudes[k];
+        }
+
+        template <typename L, typename F>
+        void for_each_input_weight(L &layer, F &&func)
+        {
+            for (std::size_t i = 0; i < layer.size(); ++i)
+            {
+                auto &&row = layer.get_weights().begin()[i];
+                for (std::size_t j = 0; j < layer.inputs(); ++j)
+                {
+                    func(row.begin()[j]);
+                }
+            }
+        }
+    };
+
+    // Zeroes the smallest-magnitude fraction `sparsity` of the input weights, ranked over
+    // the whole model or, with per_layer, separately inside each layer.
+    template <typename Model>
+    void prune_magnitude(Model &model, double sparsity, bool per_layer = false)
+    {
+        using float_t = typename Model::value_type;
+        std::vector<float_t> magnitudes;
+
+        auto collect = [&](auto &layer)
+        { detail::for_each_input_weight(layer, [&](float_t &w)
+                                        { magnitudes.push_back(fabs(w)); }); };
+        auto apply = [&](auto &layer, float_t threshold)
+        { detail::for_each_input_weight(layer, [&](float_t &w)
+                                        { if (fabs(w) < threshold) w = 0; }); };
+
+        if (per_layer)
+        {
+            model.for_each_layer([&](auto &layer)
+                                 {
+                                     magnitudes.clear();
+                                     collect(layer);
+                                     apply(layer, detail::magnitude_quantile(magnitudes, sparsity)); });
+            return;
+        }
+
+        model.for_each_layer(collect);
+        float_t const threshold = detail::magnitude_quantile(magnitudes, sparsity);
+        model.for_each_layer([&](auto &layer)
+                             { apply(layer, threshold); });
+    }
+
+    // Structured N:M sparsity: in every group of M consecutive input weights of a neuron,
+    // only the N largest in magnitude survive. Nothing is pruned when M is 0 or N >= M.
+    template <typename Model>
+    void prune_n_of_m(Model &model, std::size_t n, std::size_t m)
+    {
+        using float_t = typename Model::value_type;
+        if (m == 0 || n >= m)
+            return;
+        model.for_each_layer([&](auto &layer)
+                             {
+                                 std::vector<std::size_t> order(m);
+                                 for (std::size_t i = 0; i < layer.size(); ++i)
+                                 {
+                                     float_t *row = layer.get_weights().begin()[i].begin();
+                                     for (std::size_t g = 0; g < layer.inputs(); g += m)
+                                     {
+                                         std::size_t const len = std::min(m, layer.inputs() - g);
+                                         for (std::size_t k = 0; k < len; ++k)
+                                             order[k] = g + k;
+                                         std::sort(order.begin(), order.begin() + len, [&](std::size_t a, std::size_t b)
+                                                   { return fabs(row[a]) > fabs(row[b]); });
+                                         for (std::size_t k = n; k < len; ++k)
+                                             row[order[k]] = 0;
+                                     }
+                                 } });
+    }
+
+    // Block pruning: input weights are grouped in BLOCK-wide runs per neuron, and the
+    // fraction `sparsity` of blocks with the smallest L1 norm (over the whole model) is zeroed.
+    template <std::size_t BLOCK = 4, typename Model>
+    void prune_blocks(Model &model, double sparsity)
+    {
+        using float_t = typename Model::value_type;
+        std::vector<float_t> norms;
+
+        auto block_norms = [&](auto &layer, auto &&func)
+        {
+            for (std::size_t i = 0; i < layer.size(); ++i)
+            {
+                float_t *row = layer.get_weights().begin()[i].begin();
+                for (std::size_t b = 0; b < layer.inputs(); b += BLOCK)
+                {
+                    float_t norm = 0;
+                    std::size_t const len = std::min(BLOCK, layer.inputs() - b);
+                    for (std::size_t k = 0; k < len; ++k)
+                        norm += fabs(row[b + k]);
+                    func(row + b, len, norm);
+                }
+            }
+        };
+
+        model.for_each_layer([&](auto &layer)
+                             { block_norms(layer, [&](float_t *, std::size_t, float_t norm)
+                                           { norms.push_back(norm); }); });
+        float_t const threshold = detail::magnitude_quantile(norms, sparsity);
+        model.for_each_layer([&](auto &layer)
+                             { block_norms(layer, [&](float_t *block, std::size_t len, float_t norm)
+                                           {
+                                               if (norm < threshold)
+                                                   std::fill(block, block + len, float_t{0}); }); });
+    }
+
+    // Fraction of input weights (bias excluded) that are exactly zero.
+    template <typename Model>
+    double weight_sparsity(Model &model)
+    {
+        std::size_t zeros = 0, total = 0;
+        model.for_each_layer([&](auto &layer)
+                             { detail::for_each_input_weight(layer, [&](auto &w)
+                                                             {
+                                                                 zeros += w == 0;
+                                                                 ++total; }); });
+        return total ? (double)zeros / total : 0;
+    }
+
+    // Inference engine over block-compressed rows (BSR with 1 x BLOCK blocks).
+    template <typename float_t, std::size_t BLOCK = 4>
+    class SparseMLP
+    {
+        struct alignas(BLOCK * sizeof(float_t)) block
+        {
+            float_t w[BLOCK];
+        };
+
+        struct sparse_layer
+        {
+            std::size_t inputs;
+            std::size_t outputs;
+            std::vector<uint32_t> row_begin; // outputs + 1 offsets into block_cols/blocks
+            std::vector<uint32_t> block_cols; // first input index of each block
+            std::vector<block> blocks;
+            std::vector<float_t> bias;
+        };
+
+        std::vector<sparse_layer> layers;
+        std::vector<float_t> activations[2];
+
+        static std::size_t padded(std::size_t n) { return (n + BLOCK - 1) / BLOCK * BLOCK; }
+
+    public:
+        template <typename Model>
+        explicit SparseMLP(Model const &model)
+        {
+            std::size_t widest = 0;
+            model.for_each_layer([&](auto const &layer)
+                                 {
+                                     sparse_layer s;
+                                     s.inputs = layer.inputs();
+                                     s.outputs = layer.size();
+                                     s.row_begin.push_back(0);
+                                     for (std::size_t i = 0; i < layer.size(); ++i)
+                                     {
+                                         float_t const *row = layer.get_weights().begin()[i].begin();
+                                         for (std::size_t b = 0; b < layer.inputs(); b += BLOCK)
+                                         {
+                                             block blk = {};
+                                             bool any = false;
+                                             for (std::size_t k = 0; k < BLOCK && b + k < layer.inputs(); ++k)
+                                             {
+                                                 blk.w[k] = row[b + k];
+                                                 any |= row[b + k] != 0;
+                                             }
+                                             if (any)
+                                             {
+                                                 s.block_cols.push_back(b);
+                                                 s.blocks.push_back(blk);
+                                             }
+                                         }
+                                         s.row_begin.push_back(s.blocks.size());
+                                         s.bias.push_back(row[layer.inputs()]);
+                                     }
+                                     widest = std::max(widest, std::max(padded(s.inputs), padded(s.outputs)));
+                                     layers.push_back(std::move(s)); });
+
+            // Padding lanes stay zero so blocks may read past the last real input.
+            activations[0].assign(widest, 0);
+            activations[1].assign(widest, 0);
+        }
+
+        std::size_t stored_blocks() const
+        {
+            std::size_t n = 0;
+            for (auto const &l : layers)
+                n += l.blocks.size();
+            return n;
+        }
+
+        std::size_t bytes() const
+        {
+            std::size_t n = 0;
+            for (auto const &l : layers)
+                n += l.row_begin.size() * sizeof(uint32_t) + l.block_cols.size() * sizeof(uint32_t) +
+                     l.blocks.size() * sizeof(block) + l.bias.size() * sizeof(float_t);
+            return n;
+        }
+
+        // Multiply-adds per prediction, counting every stored block as BLOCK of them.
+        std::size_t flops() const
+        {
+            std::size_t n = 0;
+            for (auto const &l : layers)
+                n += l.blocks.size() * BLOCK + l.outputs;
+            return n;
+        }
+
+        void predict(float_t const input[], float_t output[])
+        {
+            float_t *in = activations[0].data();
+            float_t *out = activations[1].data();
+            std::copy(input, input + layers.front().inputs, in);
+            std::fill(in + layers.front().inputs, in + padded(layers.front().inputs), float_t{0});
+
+            for (auto const &l : layers)
+            {
+                for (std::size_t i = 0; i < l.outputs; ++i)
+                {
+                    float_t acc[BLOCK] = {};
+                    for (uint32_t b = l.row_begin[i]; b < l.row_begin[i + 1]; ++b)
+                    {
+                        float_t const *x = in + l.block_cols[b];
+                        for (std::size_t k = 0; k < BLOCK; ++k)
+                            acc[k] += l.blocks[b].w[k] * x[k];
+                    }
+                    float_t sum = l.bias[i];
+                    for (std::size_t k = 0; k < BLOCK; ++k)
+                        sum += acc[k];
+                    out[i] = 1 / (1 + ((float_t)(exp(-sum))));
+                }
+                std::fill(out + l.outputs, out + padded(l.outputs), float_t{0});
+                std::swap(in, out);
+            }
+
+            std::copy(in, in + layers.back().outputs, output);
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "iris.hpp"
+#include "streaming.hpp"
+#include <unistd.h>
+#include <thread>
+
+// Writes an endless (or bounded) stream of Iris training rows to stdout for
+// stream_train, reshuffled on every pass. Only the training split is streamed; the test
+// rows stay unseen.
+//
+//   ./stream_source [csv|binary] [samples, 0 = endless] [samples per second, 0 = unthrottled]
+
+#define rand_seed 0
+
+namespace st = meta_ai::streaming;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+int main(int argc, char **argv)
+{
+    bool const binary = argc > 1 && strcmp(argv[1], "binary") == 0;
+    unsigned long const samples = argc > 2 ? strtoul(argv[2], nullptr, 10) : 0;
+    double const per_second = argc > 3 ? atof(argv[3]) : 0;
+
+    // Same split as the other examples: shuffle once with the fixed seed, train on the head.
+    srand(rand_seed);
+    {
+        // readIris reports to stdout, which is the data stream here; point it at stderr meanwhile.
+        fflush(stdout);
+        int const saved = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        readIris(feat, label);
+        fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    static char out_buffer[1 << 20];
+    setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    auto const start = timeNow();
+    for (unsigned long sent = 0; samples == 0 || sent < samples;)
+    {
+        shuffle(order, train_rows);
+        for (int j = 0; j < train_rows && (samples == 0 || sent < samples); ++j, ++sent)
+        {
+            int const row = order[j];
+            bool ok;
+            if (binary)
+            {
+                st::sample<float, cols, out_cols> s;
+                memcpy(s.input, feat + row * cols, sizeof(s.input));
+                memcpy(s.answer, label + row * out_cols, sizeof(s.answer));
+                ok = fwrite(&s, sizeof(s), 1, stdout) == 1;
+            }
+            else
+            {
+                float const *f = feat + row * cols;
+                int const cls = label[row * out_cols + 1] == 1 ? 1 : label[row * out_cols + 2] == 1 ? 2 : 0;
+                ok = printf("%g,%g,%g,%g,%d\n", f[0], f[1], f[2], f[3], cls) > 0;
+            }
+            if (!ok)
+                return EXIT_SUCCESS; // reader went away
+
+            if (per_second > 0 && sent % 64 == 0)
+            {
+                fflush(stdout);
+                auto const due = start + std::chrono::nanoseconds((long long)(sent / per_second * 1e9));
+                std::this_thread::sleep_until(due);
+            }
+        }
+    }
+    fflush(stdout);
+    fprintf(stderr, "stream_source: %lu samples in %.0f ms\n", samples, duration(timeNow() - start) / 1e6);
+    return EXIT_SUCCESS;
+}
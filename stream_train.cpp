@@ -0,0 +1,128 @@
+#include "mlp.hpp"
+#include "checkpoint.hpp"
+#include "model_handle.hpp"
+#include "streaming.hpp"
+#include "iris.hpp"
+#include <fcntl.h>
+#include <signal.h>
+#include <atomic>
+#include <thread>
+
+// Trains the Iris model online from a sample stream (see streaming.hpp for the framings).
+// Every publish_every samples the weights are published to a ModelHandle, which a monitor
+// thread uses to report held-out accuracy, and handed to a background Checkpointer.
+//
+//   ./stream_source csv 2000000 | ./stream_train - csv
+//   ./stream_train [source] [csv|binary] [publish_every] [follow]
+//   source is "-" (stdin, default), a FIFO or a file; "follow" waits for the file to grow.
+
+#define learning_rate 0.1
+#define rand_seed 0
+#define checkpoint_path "stream.ckpt"
+
+namespace mai = meta_ai;
+namespace st = meta_ai::streaming;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>>;
+using Trainer = st::StreamingTrainer<Model>;
+
+Model mlp;
+
+int order[rows];
+float feat[rows * cols];
+float label[rows * out_cols];
+
+Trainer::reader_t *active_reader = nullptr;
+
+void on_signal(int)
+{
+    if (active_reader)
+        active_reader->stop();
+}
+
+int held_out_correct(Model const &model)
+{
+    float input[(rows - train_rows) * cols], output[(rows - train_rows) * out_cols];
+    for (int i = train_rows; i < rows; ++i)
+        memcpy(input + (i - train_rows) * cols, feat + order[i] * cols, cols * sizeof(float));
+    model.predict_batch(input, rows - train_rows, output);
+
+    int correct = 0;
+    for (int i = train_rows; i < rows; ++i)
+        correct += matches(output + (i - train_rows) * out_cols, label + order[i] * out_cols);
+    return correct;
+}
+
+int main(int argc, char **argv)
+{
+    char const *source = argc > 1 ? argv[1] : "-";
+    st::framing const format = argc > 2 && strcmp(argv[2], "binary") == 0 ? st::framing::binary : st::framing::csv;
+    uint64_t const publish_every = argc > 3 ? strtoull(argv[3], nullptr, 10) : 100000;
+    bool const follow = argc > 4 && strcmp(argv[4], "follow") == 0;
+
+    srand(rand_seed);
+    readIris(feat, label);
+    for (int i = 0; i < rows; ++i)
+        order[i] = i;
+    shuffle(order, rows);
+
+    int const fd = strcmp(source, "-") == 0 ? STDIN_FILENO : open(source, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(source);
+        return EXIT_FAILURE;
+    }
+
+    mai::ModelHandle<Model> handle(std::unique_ptr<Model>(new Model(mlp)));
+    mai::Checkpointer<Model> checkpointer(checkpoint_path);
+
+    Trainer::options opts;
+    opts.publish_every = publish_every;
+    opts.rate = learning_rate;
+    Trainer trainer(mlp, opts, [&](Model const &model, uint64_t trained)
+                    {
+                        handle.publish(std::unique_ptr<Model>(new Model(model)));
+                        checkpointer.request(model, trained); });
+
+    Trainer::reader_t reader(fd, format, follow);
+    active_reader = &reader;
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    std::atomic<bool> done{false};
+    std::thread monitor([&]
+                        {
+                            mai::ModelHandle<Model>::reader view(handle);
+                            uint64_t last = 0;
+                            auto t = timeNow();
+                            while (!done)
+                            {
+                                std::this_thread::sleep_for(std::chrono::seconds(1));
+                                uint64_t const now = trainer.samples_trained();
+                                auto const t1 = timeNow();
+                                int correct;
+                                {
+                                    auto model = view.pin();
+                                    correct = held_out_correct(*model);
+                                }
+                                printf("trained %10lu  %9.0f samples/s  backpressure waits %8lu  snapshots %4lu  held-out %d/%d\n",
+                                       (unsigned long)now, (now - last) / (duration(t1 - t) / 1e9), trainer.backpressure_waits(),
+                                       (unsigned long)trainer.snapshots_taken(), correct, rows - train_rows);
+                                fflush(stdout);
+                                last = now;
+                                t = t1;
+                            } });
+
+    auto const start = timeNow();
+    uint64_t const trained = trainer.run(reader);
+    double const seconds = duration(timeNow() - start) / 1e9;
+    done = true;
+    monitor.join();
+    checkpointer.wait();
+
+    printf("stream ended: %lu samples in %.2f s (%.0f samples/s), %lu skipped lines, %lu backpressure waits, %lu snapshots, %lu checkpoints\n",
+           (unsigned long)trained, seconds, trained / seconds, reader.skipped_lines(), trainer.backpressure_waits(),
+           (unsigned long)trainer.snapshots_taken(), checkpointer.checkpoints_written());
+    printf("held-out correct: %d/%d\n", held_out_correct(mlp), rows - train_rows);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,443 @@
+#ifndef __STREAMING_H__
+#define __STREAMING_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Online training from a byte stream (stdin, a FIFO or a file that keeps growing).
+//
+// A reader thread parses samples and pushes them into a bounded SPSC queue; the
+// training thread pops them, decorrelates their order through a fixed-size shuffle
+// buffer and calls MLP::train. Memory is bounded by the queue and the buffer: when
+// training falls behind, the queue fills, the reader stops reading, and the writer of
+// the pipe blocks. Every publish_every trained samples the model is handed to a
+// snapshot callback, e.g. to ModelHandle::publish or Checkpointer::request.
+
+namespace meta_ai
+{
+    namespace streaming
+    {
+        // csv:    one sample per line, INPUTS values followed by either OUTPUTS target
+        //         values or a single class index (one-hot encoded), as in iris.data.
+        //         Lines with any other number of fields, or longer than MAX_LINE bytes,
+        //         are skipped.
+        // binary: fixed records of INPUTS + OUTPUTS native floats, no header.
+        enum class framing
+        {
+            csv,
+            binary,
+        };
+
+        template <typename float_t, std::size_t INPUTS, std::size_t OUTPUTS>
+        struct sample
+        {
+            float_t input[INPUTS];
+            float_t answer[OUTPUTS];
+        };
+
+        namespace detail
+        {
+            // Spin briefly, then yield, then sleep: cheap when the other side is about to
+            // move, and no burnt core when it is stalled.
+            inline void backoff(unsigned &spins)
+            {
+                if (++spins < 64)
+                    return;
+                if (spins < 256)
+                    std::this_thread::yield();
+                else
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+
+            inline uint64_t xorshift(uint64_t &state)
+            {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                return state;
+            }
+        };
+
+        // Bounded lock-free single-producer single-consumer ring.
+        template <typename T>
+        class SpscQueue
+        {
+            std::vector<T> slots;
+            std::size_t const mask;
+
+            alignas(64) std::atomic<std::size_t> head{0}; // next slot to pop
+            alignas(64) std::atomic<std::size_t> tail{0}; // next slot to push
+            alignas(64) std::atomic<bool> closed{false};
+            std::atomic<unsigned long> full{0};
+
+            static std::size_t round_up(std::size_t n)
+            {
+                std::size_t p = 1;
+                while (p < n)
+                    p <<= 1;
+                return p;
+            }
+
+        public:
+            explicit SpscQueue(std::size_t capacity) : slots(round_up(capacity)), mask(slots.size() - 1) {}
+
+            // Blocks while the queue is full. False once the queue is closed.
+            bool push(T const &item)
+            {
+                std::size_t const t = tail.load(std::memory_order_relaxed);
+                if (t - head.load(std::memory_order_acquire) == slots.size())
+                {
+                    ++full;
+                    unsigned spins = 0;
+                    while (t - head.load(std::memory_order_acquire) == slots.size())
+                    {
+                        if (closed.load(std::memory_order_relaxed))
+                            return false;
+                        detail::backoff(spins);
+                    }
+                }
+                if (closed.load(std::memory_order_relaxed))
+                    return false;
+                slots[t & mask] = item;
+                tail.store(t + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Blocks while the queue is empty. False once it is closed and drained.
+            bool pop(T &item)
+            {
+                std::size_t const h = head.load(std::memory_order_relaxed);
+                unsigned spins = 0;
+                while (tail.load(std::memory_order_acquire) == h)
+                {
+                    if (closed.load(std::memory_order_acquire) && tail.load(std::memory_order_acquire) == h)
+                        return false;
+                    detail::backoff(spins);
+                }
+                item = slots[h & mask];
+                head.store(h + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Non-blocking pop, for consumers that poll several queues.
+            bool try_pop(T &item)
+            {
+                std::size_t const h = head.load(std::memory_order_relaxed);
+                if (tail.load(std::memory_order_acquire) == h)
+                    return false;
+                item = slots[h & mask];
+                head.store(h + 1, std::memory_order_release);
+                return true;
+            }
+
+            void close() { closed.store(true, std::memory_order_release); }
+
+            std::size_t capacity() const { return slots.size(); }
+
+            // Pushes that found the queue full, i.e. how often backpressure kicked in.
+            unsigned long full_waits() const { return full.load(); }
+        };
+
+        // Fixed-capacity shuffle buffer. Until it is full, samples are only stored; after
+        // that every new sample replaces a uniformly chosen resident, which is returned for
+        // training. Each sample is trained on once, in an order randomized over a window of
+        // `capacity` samples. replay() draws a resident for an extra pass over recent data.
+        template <typename T>
+        class ReplayBuffer
+        {
+            std::vector<T> items;
+            std::size_t const capacity;
+            uint64_t rng;
+
+        public:
+            explicit ReplayBuffer(std::size_t capacity, uint64_t seed = 0x9E3779B97F4A7C15ull)
+                : capacity(capacity ? capacity : 1), rng(seed | 1)
+            {
+                items.reserve(this->capacity);
+            }
+
+            // True if evicted now holds a sample to train on.
+            bool add(T const &item, T &evicted)
+            {
+                if (items.size() < capacity)
+                {
+                    items.push_back(item);
+                    return false;
+                }
+                T &slot = items[detail::xorshift(rng) % items.size()];
+                evicted = slot;
+                slot = item;
+                return true;
+            }
+
+            T const &replay() { return items[detail::xorshift(rng) % items.size()]; }
+
+            // Removes a random resident; false when empty. Used to flush at end of stream.
+            bool drain(T &item)
+            {
+                if (items.empty())
+                    return false;
+                std::size_t const i = detail::xorshift(rng) % items.size();
+                item = items[i];
+                items[i] = items.back();
+                items.pop_back();
+                return true;
+            }
+
+            std::size_t size() const { return items.size(); }
+        };
+
+        // Parses samples from a file descriptor. With follow, end of file is not the end of
+        // the stream: the reader waits for more data (tail -f), until stop() is called.
+        template <typename float_t, std::size_t INPUTS, std::size_t OUTPUTS>
+        class SampleReader
+        {
+            int const fd;
+            framing const format;
+            bool const follow;
+            std::atomic<bool> stopped{false};
+
+            std::vector<char> buffer;
+            std::size_t begin = 0, end = 0;
+            bool eof = false;
+            bool overlong = false; // dropping the rest of a line that did not fit
+            unsigned long skipped = 0;
+
+            // Refills the buffer, keeping the unparsed tail, which must leave room. False at
+            // end of stream.
+            bool fill()
+            {
+                if (begin > 0)
+                {
+                    memmove(buffer.data(), buffer.data() + begin, end - begin);
+                    end -= begin;
+                    begin = 0;
+                }
+
+                while (!stopped.load(std::memory_order_relaxed))
+                {
+                    // Bounded waits so stop() is noticed even on a silent pipe.
+                    pollfd p = {fd, POLLIN, 0};
+                    int const ready = poll(&p, 1, 100);
+                    if (ready < 0 && errno != EINTR)
+                        return false;
+                    if (ready <= 0)
+                        continue;
+
+                    ssize_t const n = read(fd, buffer.data() + end, buffer.size() - end);
+                    if (n > 0)
+                    {
+                        end += (std::size_t)n;
+                        return true;
+                    }
+                    if (n < 0 && errno != EINTR && errno != EAGAIN)
+                        return false;
+                    if (n == 0)
+                    {
+                        if (!follow)
+                            return false;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    }
+                }
+                return false;
+            }
+
+            bool parse_line(char *line, sample<float_t, INPUTS, OUTPUTS> &s)
+            {
+                float_t values[INPUTS + OUTPUTS];
+                std::size_t n = 0;
+                char *p = line;
+                while (*p && n < INPUTS + OUTPUTS)
+                {
+                    char *next;
+                    float_t const v = (float_t)strtod(p, &next);
+                    if (next == p)
+                        break;
+                    values[n++] = v;
+                    p = next;
+                    while (*p == ',' || *p == ' ' || *p == '\t' || *p == '\r')
+                        ++p;
+                }
+
+                if (n == INPUTS + OUTPUTS && *p == 0)
+                {
+                    memcpy(s.input, values, sizeof(s.input));
+                    memcpy(s.answer, values + INPUTS, sizeof(s.answer));
+                    return true;
+                }
+                if (n != INPUTS + 1 || *p != 0)
+                    return false;
+                long const label = (long)values[INPUTS];
+                if (label < 0 || (std::size_t)label >= OUTPUTS)
+                    return false;
+                memcpy(s.input, values, sizeof(s.input));
+                memset(s.answer, 0, sizeof(s.answer));
+                s.answer[label] = 1;
+                return true;
+            }
+
+        public:
+            // Longest CSV line kept, newline included; the buffer never grows past it.
+            static constexpr std::size_t MAX_LINE = 1 << 16;
+
+            SampleReader(int fd, framing format, bool follow = false)
+                : fd(fd), format(format), follow(follow), buffer(std::max(MAX_LINE, sizeof(sample<float_t, INPUTS, OUTPUTS>))) {}
+
+            // False at end of stream (or after stop()).
+            bool next(sample<float_t, INPUTS, OUTPUTS> &s)
+            {
+                for (;;)
+                {
+                    if (format == framing::binary)
+                    {
+                        if (end - begin >= sizeof(s))
+                        {
+                            memcpy(&s, buffer.data() + begin, sizeof(s));
+                            begin += sizeof(s);
+                            return true;
+                        }
+                    }
+                    else
+                    {
+                        char *const first = buffer.data() + begin;
+                        char *const newline = (char *)memchr(first, '\n', end - begin);
+                        if (!overlong && !newline && end - begin == buffer.size())
+                        {
+                            ++skipped;
+                            overlong = true;
+                        }
+                        if (overlong)
+                        {
+                            // Drop what has come of the line so far; parse again after its end.
+                            begin = newline ? newline - buffer.data() + 1 : end;
+                            overlong = !newline;
+                            if (newline)
+                                continue;
+                        }
+                        else if (newline || (eof && end > begin))
+                        {
+                            char *const last = newline ? newline : buffer.data() + end;
+                            *last = 0;
+                            begin = last - buffer.data() + (newline ? 1 : 0);
+                            if (!newline)
+                                end = begin;
+                            if (parse_line(first, s))
+                                return true;
+                            ++skipped;
+                            continue;
+                        }
+                    }
+
+                    if (eof)
+                        return false;
+                    if (!fill())
+                        eof = true; // a final CSV line without a newline still counts
+                }
+            }
+
+            void stop() { stopped = true; }
+
+            // CSV lines that did not parse or were too long.
+            unsigned long skipped_lines() const { return skipped; }
+        };
+
+        template <typename Model>
+        class StreamingTrainer
+        {
+        public:
+            using float_t = typename Model::value_type;
+            using sample_t = sample<float_t, Model::inputs(), Model::outputs()>;
+            using reader_t = SampleReader<float_t, Model::inputs(), Model::outputs()>;
+            using snapshot_fn = std::function<void(Model const &, uint64_t trained)>;
+
+            struct options
+            {
+                std::size_t queue_capacity = 4096;
+                std::size_t shuffle_capacity = 1024;
+                unsigned replay = 0; // extra trains on buffered samples per new sample
+                uint64_t publish_every = 10000;
+                float_t rate = 0.1;
+            };
+
+        private:
+            Model &model;
+            options const opts;
+            snapshot_fn const on_snapshot;
+
+            SpscQueue<sample_t> queue;
+            ReplayBuffer<sample_t> buffer;
+
+            std::atomic<uint64_t> received{0};
+            std::atomic<uint64_t> trained{0};
+            std::atomic<uint64_t> snapshots{0};
+
+            void train(sample_t const &s)
+            {
+                model.train(s.input, s.answer, opts.rate);
+                uint64_t const n = trained.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (opts.publish_every && n % opts.publish_every == 0)
+                    snapshot(n);
+            }
+
+            void snapshot(uint64_t n)
+            {
+                if (on_snapshot)
+                    on_snapshot(model, n);
+                ++snapshots;
+            }
+
+        public:
+            StreamingTrainer(Model &model, options opts, snapshot_fn on_snapshot = nullptr)
+                : model(model), opts(opts), on_snapshot(std::move(on_snapshot)),
+                  queue(opts.queue_capacity), buffer(opts.shuffle_capacity) {}
+
+            // Trains on the calling thread until the reader's stream ends, then flushes the
+            // shuffle buffer and takes a final snapshot. Returns the samples trained on.
+            uint64_t run(reader_t &reader)
+            {
+                std::thread producer([&]
+                                     {
+                                         sample_t s;
+                                         while (reader.next(s))
+                                         {
+                                             if (!queue.push(s))
+                                                 break;
+                                             received.fetch_add(1, std::memory_order_relaxed);
+                                         }
+                                         queue.close(); });
+
+                sample_t s, evicted;
+                while (queue.pop(s))
+                {
+                    if (buffer.add(s, evicted))
+                        train(evicted);
+                    for (unsigned r = 0; r < opts.replay && buffer.size() > 0; ++r)
+                        train(buffer.replay());
+                }
+                producer.join();
+
+                while (buffer.drain(s))
+                    train(s);
+                snapshot(trained);
+                return trained;
+            }
+
+            uint64_t samples_received() const { return received; }
+            uint64_t samples_trained() const { return trained; }
+            uint64_t snapshots_taken() const { return snapshots; }
+            unsigned long backpressure_waits() const { return queue.full_waits(); }
+        };
+    };
+};
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <stdint.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mlp.hpp"
+#include "numerics.hpp"
+
+// k-fold cross-validation of many hyperparameter configurations in one process.
+//
+// The dataset is loaded once into a Dataset and shared read-only by every job; a job
+// (one configuration on one fold) owns its MLP, its seed and its shuffle order, so jobs
+// need no synchronization besides the scheduler's. Jobs are spread over the queues of a
+// WorkStealingPool; a worker runs its own queue from the back and, when empty, steals
+// from the front of the others', so long and short configurations still finish together.
+
+namespace meta_ai
+{
+    // Blocking batch executor over persistent threads, one job deque per thread.
+    class WorkStealingPool
+    {
+        struct alignas(64) job_queue
+        {
+            std::mutex lock;
+            std::deque<std::function<void()>> jobs;
+        };
+
+        std::vector<std::unique_ptr<job_queue>> queues;
+        std::vector<std::thread> threads;
+
+        std::mutex lock;
+        std::condition_variable wake, done;
+        std::size_t remaining = 0;
+        uint64_t generation = 0;
+        bool stopping = false;
+        std::atomic<unsigned long> steals{0};
+
+        bool take(std::size_t self, std::function<void()> &job)
+        {
+            {
+                job_queue &own = *queues[self];
+                std::lock_guard<std::mutex> guard(own.lock);
+                if (!own.jobs.empty())
+                {
+                    job = std::move(own.jobs.back());
+                    own.jobs.pop_back();
+                    return true;
+                }
+            }
+            for (std::size_t i = 1; i < queues.size(); ++i)
+            {
+                job_queue &victim = *queues[(self + i) % queues.size()];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if (!victim.jobs.empty())
+                {
+                    job = std::move(victim.jobs.front());
+                    victim.jobs.pop_front();
+                    ++steals;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void work(std::size_t self)
+        {
+            uint64_t seen = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait(guard, [&]
+                              { return stopping || generation != seen; });
+                    if (stopping)
+                        return;
+                    seen = generation;
+                }
+
+                std::function<void()> job;
+                while (take(self, job))
+                {
+                    detail::follow_denormal_mode();
+                    job();
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (--remaining == 0)
+                        done.notify_all();
+                }
+            }
+        }
+
+    public:
+        explicit WorkStealingPool(std::size_t n_threads = std::thread::hardware_concurrency())
+        {
+            n_threads = n_threads ? n_threads : 1;
+            for (std::size_t i = 0; i < n_threads; ++i)
+                queues.emplace_back(new job_queue);
+            for (std::size_t i = 0; i < n_threads; ++i)
+                threads.emplace_back([this, i]
+                                     { work(i); });
+        }
+
+        ~WorkStealingPool()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto &thread : threads)
+                thread.join();
+        }
+
+        // Runs every job and returns when all have finished; one run at a time. Jobs are
+        // dealt round-robin, job j to queue j % size(), so each queue holds every size()-th
+        // job and neighbours in submission order (e.g. the folds of one configuration) start
+        // on different threads.
+        void run(std::vector<std::function<void()>> jobs)
+        {
+            if (jobs.empty())
+                return;
+            {
+                // Counted before they are visible: a worker still draining may pick them up at once.
+                std::lock_guard<std::mutex> guard(lock);
+                remaining = jobs.size();
+            }
+            for (std::size_t j = 0; j < jobs.size(); ++j)
+            {
+                job_queue &queue = *queues[j % queues.size()];
+                std::lock_guard<std::mutex> guard(queue.lock);
+                queue.jobs.push_back(std::move(jobs[j]));
+            }
+
+            std::unique_lock<std::mutex> guard(lock);
+            ++generation;
+            wake.notify_all();
+            done.wait(guard, [&]
+                      { return remaining == 0; });
+        }
+
+        std::size_t size() const { return threads.size(); }
+
+        // Jobs run by a thread other than the one they were dealt to.
+        unsigned long stolen() const { return steals.load(); }
+    };
+
+    // n row-major samples, loaded once and shared read-only between jobs.
+    template <typename float_t, std::size_t INPUTS, std::size_t OUTPUTS>
+    struct Dataset
+    {
+        std::vector<float_t> input;
+        std::vector<float_t> answer;
+
+        Dataset(float_t const in[], float_t const out[], std::size_t n)
+            : input(in, in + n * INPUTS), answer(out, out + n * OUTPUTS) {}
+
+        std::size_t size() const { return answer.size() / OUTPUTS; }
+        float_t const *input_row(std::size_t i) const { return input.data() + i * INPUTS; }
+        float_t const *answer_row(std::size_t i) const { return answer.data() + i * OUTPUTS; }
+    };
+
+    struct sweep_config
+    {
+        float rate = 0.1f;
+        unsigned epochs = 1000;
+        bool xavier = false; // xavier_init() instead of the default [0, 1] weights
+    };
+
+    struct fold_result
+    {
+        std::size_t config;
+        std::size_t fold;
+        float accuracy; // argmax class on the held-out fold
+        float mse;      // mean squared error per output on the held-out fold
+        double train_ms;
+    };
+
+    namespace detail
+    {
+        inline uint64_t splitmix64(uint64_t &state)
+        {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // Fisher-Yates with a job-local generator, so concurrent jobs stay reproducible.
+        inline void shuffle(std::vector<uint32_t> &order, uint64_t &rng)
+        {
+            for (std::size_t i = order.size(); i > 1; --i)
+                std::swap(order[i - 1], order[splitmix64(rng) % i]);
+        }
+
+        template <typename Model, typename Data>
+        fold_result run_fold(Data const &data, std::vector<uint32_t> const &order, std::size_t k,
+                             std::size_t fold, std::size_t config_index, sweep_config const &config, uint64_t seed)
+        {
+            using float_t = typename Model::value_type;
+            std::size_t const n = order.size();
+            std::size_t const begin = fold * n / k, end = (fold + 1) * n / k;
+
+            std::vector<uint32_t> train(order.begin(), order.begin() + begin);
+            train.insert(train.end(), order.begin() + end, order.end());
+
+            // The constructor draws from the global fast_rand stream, which other jobs share;
+            // the weights are then redrawn from the job's own seed.
+            std::unique_ptr<Model> model;
+            {
+                static std::mutex construction;
+                std::lock_guard<std::mutex> lk(construction);
+                model = std::make_unique<Model>();
+            }
+            uint64_t rng = seed;
+            unsigned weight_seed = (unsigned)splitmix64(rng);
+            model->uniform_init(weight_seed);
+            if (config.xavier)
+                model->xavier_init(weight_seed);
+
+            auto const t0 = std::chrono::steady_clock::now();
+            for (unsigned e = 0; e < config.epochs; ++e)
+            {
+                shuffle(train, rng);
+                for (uint32_t row : train)
+                    model->train(data.input_row(row), data.answer_row(row), config.rate);
+            }
+            double const train_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            std::size_t correct = 0;
+            double squared = 0;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                auto const &prediction = model->predict(data.input_row(order[i]));
+                float_t const *answer = data.answer_row(order[i]);
+                std::size_t best = 0;
+                for (std::size_t o = 0; o < Model::outputs(); ++o)
+                {
+                    double const d = prediction[o] - answer[o];
+                    squared += d * d;
+                    if (prediction[o] > prediction[best])
+                        best = o;
+                }
+                correct += answer[best] == 1;
+            }
+            std::size_t const held_out = end - begin ? end - begin : 1;
+            return {config_index, fold, (float)correct / held_out, (float)(squared / (held_out * Model::outputs())), train_ms};
+        }
+    };
+
+    // Cross-validates every configuration with k folds: configs.size() * k jobs on pool.
+    // Folds come from one shuffle of the dataset by seed, the same for every configuration;
+    // each job seeds its weights and epoch order from (seed, config, fold). Results are in
+    // job order: config-major, then fold.
+    template <typename Model, typename Data>
+    std::vector<fold_result> cross_validate(WorkStealingPool &pool, Data const &data, std::vector<sweep_config> const &configs,
+                                            std::size_t k, uint64_t seed = 1)
+    {
+        std::vector<uint32_t> order(data.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+            order[i] = (uint32_t)i;
+        uint64_t rng = seed;
+        detail::shuffle(order, rng);
+
+        std::vector<fold_result> results(configs.size() * k);
+        std::vector<std::function<void()>> jobs;
+        for (std::size_t c = 0; c < configs.size(); ++c)
+        {
+            for (std::size_t f = 0; f < k; ++f)
+            {
+                uint64_t job_seed = seed ^ (c * k + f + 1) * 0xD1B54A32D192ED03ull;
+                job_seed = detail::splitmix64(job_seed);
+                jobs.push_back([&, c, f, job_seed]
+                               { results[c * k + f] = detail::run_fold<Model>(data, order, k, f, c, configs[c], job_seed); });
+            }
+        }
+        pool.run(std::move(jobs));
+        return results;
+    }
+
+    struct config_summary
+    {
+        float mean_accuracy, std_accuracy;
+        float mean_mse;
+        double train_ms; // summed over folds
+    };
+
+    // Per-configuration mean and spread over the folds of cross_validate's results.
+    inline std::vector<config_summary> summarize(std::vector<fold_result> const &results, std::size_t n_configs)
+    {
+        std::vector<config_summary> summary(n_configs, config_summary{0, 0, 0, 0});
+        std::vector<std::size_t> folds(n_configs, 0);
+        for (auto const &r : results)
+        {
+            summary[r.config].mean_accuracy += r.accuracy;
+            summary[r.config].mean_mse += r.mse;
+            summary[r.config].train_ms += r.train_ms;
+            ++folds[r.config];
+        }
+        for (std::size_t c = 0; c < n_configs; ++c)
+        {
+            if (!folds[c])
+                continue;
+            summary[c].mean_accuracy /= folds[c];
+            summary[c].mean_mse /= folds[c];
+        }
+        for (auto const &r : results)
+        {
+            float const d = r.accuracy - summary[r.config].mean_accuracy;
+            summary[r.config].std_accuracy += d * d;
+        }
+        for (std::size_t c = 0; c < n_configs; ++c)
+        {
+            if (folds[c])
+                summary[c].std_accuracy = sqrtf(summary[c].std_accuracy / folds[c]);
+        }
+        return summary;
+    }
+};
+
+#endif
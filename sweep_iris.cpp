@@ -0,0 +1,48 @@
+#include "mlp.hpp"
+#include "sweep.hpp"
+#include "iris.hpp"
+
+// 5-fold cross-validation of a learning-rate x epochs x initialization grid on Iris, all
+// jobs in one process over one shared copy of the data.
+//
+//   ./sweep_iris [threads] [folds]     threads defaults to every core
+
+namespace mai = meta_ai;
+
+using Model = mai::MLP<float, mai::INPUT<cols>, mai::HIDDEN<7, 3>, mai::OUTPUT<out_cols>>;
+
+float feat[rows * cols];
+float label[rows * out_cols];
+
+int main(int argc, char **argv)
+{
+    std::size_t const threads = argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+    std::size_t const folds = argc > 2 ? atoi(argv[2]) : 5;
+
+    readIris(feat, label);
+    mai::Dataset<float, cols, out_cols> const data(feat, label, rows);
+
+    std::vector<mai::sweep_config> configs;
+    for (float rate : {0.01f, 0.03f, 0.1f, 0.3f})
+        for (unsigned epochs : {200u, 1000u})
+            for (bool xavier : {false, true})
+                configs.push_back({rate, epochs, xavier});
+
+    mai::WorkStealingPool pool(threads);
+    std::vector<mai::fold_result> results;
+    double const wall_ms = funcTime([&]
+                                    { results = mai::cross_validate<Model>(pool, data, configs, folds); }) / 1e6;
+    auto const summary = mai::summarize(results, configs.size());
+
+    printf("%7s %7s %7s   %-15s %8s %10s\n", "rate", "epochs", "init", "accuracy", "mse", "train ms");
+    double job_ms = 0;
+    for (std::size_t c = 0; c < configs.size(); ++c)
+    {
+        printf("%7.2f %7u %7s   %.3f +- %.3f  %8.4f %10.1f\n", configs[c].rate, configs[c].epochs, configs[c].xavier ? "xavier" : "default",
+               summary[c].mean_accuracy, summary[c].std_accuracy, summary[c].mean_mse, summary[c].train_ms);
+        job_ms += summary[c].train_ms;
+    }
+    printf("%zu jobs on %zu threads (%lu stolen): %.0f ms wall, %.0f ms summed over jobs (%.2f jobs in flight)\n",
+           results.size(), pool.size(), pool.stolen(), wall_ms, job_ms, job_ms / wall_ms);
+    return EXIT_SUCCESS;
+}